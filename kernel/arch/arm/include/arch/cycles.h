@@ -0,0 +1,13 @@
+#pragma once
+
+#include <common/types.h>
+#include <common/attributes.h>
+
+// Raw, uncalibrated virtual counter value
+static ALWAYS_INLINE u64 arch_read_cycles(void)
+{
+    u64 value;
+
+    asm volatile("isb\n\tmrs %0, cntvct_el0" : "=r"(value) :: "memory");
+    return value;
+}
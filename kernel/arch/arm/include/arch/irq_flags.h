@@ -0,0 +1,36 @@
+#pragma once
+
+#include <common/types.h>
+#include <common/attributes.h>
+
+#define ARM_DAIF_I (1 << 7)
+
+static ALWAYS_INLINE void arch_irq_enable(void)
+{
+    asm volatile("msr daifclr, #2" ::: "memory");
+}
+
+static ALWAYS_INLINE void arch_irq_disable(void)
+{
+    asm volatile("msr daifset, #2" ::: "memory");
+}
+
+// WFI wakes up on a pending interrupt even if it's masked
+static ALWAYS_INLINE void arch_irq_enable_and_wait(void)
+{
+    asm volatile("wfi\n\tmsr daifclr, #2" ::: "memory");
+}
+
+static ALWAYS_INLINE ptr_t arch_irq_save(void)
+{
+    ptr_t flags;
+
+    asm volatile("mrs %0, daif\n\tmsr daifset, #2" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static ALWAYS_INLINE void arch_irq_restore(ptr_t flags)
+{
+    if (!(flags & ARM_DAIF_I))
+        arch_irq_enable();
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <common/types.h>
+#include <common/attributes.h>
+
+// TPIDR_EL1 holds the offset from the template to this CPU's copy
+static ALWAYS_INLINE ptr_t arch_this_cpu_offset(void)
+{
+    ptr_t offset;
+
+    asm volatile("mrs %0, tpidr_el1" : "=r"(offset));
+    return offset;
+}
+
+static ALWAYS_INLINE void arch_percpu_activate(ptr_t offset)
+{
+    asm volatile("msr tpidr_el1, %0" :: "r"(offset) : "memory");
+}
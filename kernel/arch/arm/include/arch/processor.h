@@ -0,0 +1,8 @@
+#pragma once
+
+#include <common/attributes.h>
+
+static ALWAYS_INLINE void arch_cpu_relax(void)
+{
+    asm volatile("yield" ::: "memory");
+}
@@ -1,5 +1,6 @@
 #define MSG_FMT(msg) "earlycon: " msg
 
+#include <common/conversions.h>
 #include <common/error.h>
 #include <common/helpers.h>
 #include <common/types.h>
@@ -8,6 +9,7 @@
 #include <console.h>
 #include <io.h>
 #include <param.h>
+#include <uart_16550.h>
 #include <arch/private/hypervisor.h>
 
 static void e9_write(struct console *con, const char *str, size_t count)
@@ -50,23 +52,127 @@ unmap:
 }
 INITCALL(e9_console_init);
 
+#define UART_DEFAULT_PORT 0x3F8
+#define UART_DEFAULT_BAUD 115200
+
+static struct uart_16550 g_uart;
+
+// Pops the next comma-separated argument off 'args'
+static bool uart_next_arg(struct string *args, struct string *out)
+{
+    ssize_t comma;
+
+    if (str_empty(*args))
+        return false;
+
+    comma = str_find_one(*args, ',', 0);
+    if (comma < 0) {
+        *out = *args;
+        str_offset_by(args, args->size);
+        return true;
+    }
+
+    *out = str_substring(*args, 0, comma);
+    str_offset_by(args, comma + 1);
+    return true;
+}
+
+/*
+ * Format is uart[,<port>[,<baud>]], port defaults to COM1 and baud to the
+ * maximum rate supported by the standard 1.8432 MHz clock.
+ */
+static error_t uart_console_init(struct string args)
+{
+    struct string arg;
+    u16 port = UART_DEFAULT_PORT;
+    u32 baud = UART_DEFAULT_BAUD;
+    io_window *iow;
+    error_t ret;
+
+    if (uart_next_arg(&args, &arg) && !str_empty(arg)) {
+        ret = str_to_u16(arg, &port);
+        if (is_error(ret))
+            return ret;
+    }
+
+    if (uart_next_arg(&args, &arg) && !str_empty(arg)) {
+        ret = str_to_u32(arg, &baud);
+        if (is_error(ret))
+            return ret;
+    }
+
+    if (!str_empty(args))
+        return EINVAL;
+
+    iow = io_window_map_pio(port, 8);
+    if (error_ptr(iow))
+        return decode_error_ptr(iow);
+
+    ret = uart_16550_init(&g_uart, iow, baud);
+    if (is_error(ret))
+        goto unmap;
+
+    ret = register_console(&g_uart.con);
+    if (unlikely(ret))
+        goto unmap;
+
+    return ret;
+
+unmap:
+    g_uart.iow = NULL;
+    io_window_unmap(iow);
+    return ret;
+}
+
+static error_t uart_console_destroy(void)
+{
+    error_t ret;
+
+    ret = unregister_console(&g_uart.con);
+    if (is_error(ret))
+        return ret;
+
+    io_window_unmap(g_uart.iow);
+    g_uart.iow = NULL;
+    return EOK;
+}
+
 #define EARLYCON_MODE_NONE STR_CONSTEXPR("none")
 #define EARLYCON_MODE_E9 STR_CONSTEXPR("e9")
+#define EARLYCON_MODE_UART STR_CONSTEXPR("uart")
 
 struct string g_earlycon = EARLYCON_MODE_NONE;
 
+// Matches "uart[,args...]", stores the arguments into 'out_args'
+static bool earlycon_is_uart(struct string mode, struct string *out_args)
+{
+    struct string name;
+
+    if (!uart_next_arg(&mode, &name) ||
+        !str_equals_caseless(name, EARLYCON_MODE_UART))
+        return false;
+
+    if (out_args)
+        *out_args = mode;
+
+    return true;
+}
+
 static error_t earlycon_destroy(void)
 {
     if (str_equals_caseless(g_earlycon, EARLYCON_MODE_E9))
         return unregister_console(&e9_console);
 
+    if (earlycon_is_uart(g_earlycon, NULL))
+        return uart_console_destroy();
+
     return EOK;
 }
 
 static error_t earlycon_set(struct string mode, struct param *p)
 {
     error_t ret;
-    struct string *cur = p->value;
+    struct string args, *cur = p->value;
 
     ret = earlycon_destroy();
     if (is_error(ret))
@@ -86,6 +192,15 @@ static error_t earlycon_set(struct string mode, struct param *p)
         goto out_ok;
     }
 
+    if (earlycon_is_uart(mode, &args)) {
+        ret = uart_console_init(args);
+        if (is_error(ret))
+            return ret;
+
+        *cur = EARLYCON_MODE_UART;
+        goto out_ok;
+    }
+
     return EINVAL;
 
 out_ok:
@@ -3,6 +3,11 @@
 
 #include <arch/private/descriptors.h>
 #include <arch/private/idt.h>
+#include <arch/private/page.h>
+#include <arch/private/pic.h>
+#include <arch/private/string.h>
+
+#include <percpu.h>
 
 static descriptor_t g_gdt[NUM_GDT_ENTRIES] = {
     [DESC_IDX(KERNEL_CS)] = SEGMENT_KERNEL_CODE64,
@@ -20,6 +25,12 @@ void arch_init_early(void)
     };
     load_gdt(&gdt_ptr);
 
+    // Reloading the segment registers has reset the GS base
+    arch_percpu_activate(g_percpu_offsets[0]);
+
+    x86_string_init();
+    x86_page_ops_init();
+    x86_pic_disable();
     idt_init();
 }
 
@@ -3,9 +3,13 @@
 
 #include <linker.h>
 
+#include <common/atomic.h>
 #include <common/types.h>
 
+#include <bug.h>
+
 extern ptr_t LINKER_SYMBOL(idt_thunks)[];
+extern ptr_t LINKER_SYMBOL(idt_fast_thunks)[];
 BUILD_BUG_ON(IDT_THUNK_SIZE != sizeof(ptr_t));
 
 struct interrupt_descriptor {
@@ -39,3 +43,25 @@ void idt_init(void)
 
     idt_load();
 }
+
+void idt_set_fast_irq_entry(u32 vector, bool fast)
+{
+    ptr_t thunk;
+
+    BUG_ON(vector < NUM_X86_EXCEPTIONS || vector >= NUM_IDT_ENTRIES);
+
+    if (fast) {
+        size_t irq_idx = vector - NUM_X86_EXCEPTIONS;
+        thunk = (ptr_t)&LINKER_SYMBOL(idt_fast_thunks)[irq_idx];
+    } else
+        thunk = (ptr_t)&LINKER_SYMBOL(idt_thunks)[vector];
+
+    /*
+     * Both thunk tables live within the same 4GiB of kernel text, so only the
+     * low half of the descriptor differs and can be swapped atomically while
+     * the IDT is live.
+     */
+    BUG_ON(g_idt[vector].high != INTERRUPT_DESCRIPTOR_HIGH(thunk));
+    atomic_store_relaxed(&g_idt[vector].low,
+                         INTERRUPT_DESCRIPTOR_LOW(thunk, 0, 0));
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <common/types.h>
+#include <common/attributes.h>
+
+// Raw, uncalibrated timestamp counter value
+static ALWAYS_INLINE u64 arch_read_cycles(void)
+{
+    u32 lo, hi;
+
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((u64)hi << 32) | lo;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <common/types.h>
+#include <common/attributes.h>
+
+#define X86_FLAGS_IF (1 << 9)
+
+static ALWAYS_INLINE void arch_irq_enable(void)
+{
+    asm volatile("sti" ::: "memory");
+}
+
+static ALWAYS_INLINE void arch_irq_disable(void)
+{
+    asm volatile("cli" ::: "memory");
+}
+
+// STI only takes effect after the next instruction, so no interrupt is missed
+static ALWAYS_INLINE void arch_irq_enable_and_wait(void)
+{
+    asm volatile("sti\n\thlt" ::: "memory");
+}
+
+static ALWAYS_INLINE ptr_t arch_irq_save(void)
+{
+    ptr_t flags;
+
+    asm volatile("pushf\n\tpop %0\n\tcli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static ALWAYS_INLINE void arch_irq_restore(ptr_t flags)
+{
+    if (flags & X86_FLAGS_IF)
+        arch_irq_enable();
+}
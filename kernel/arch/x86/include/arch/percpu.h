@@ -0,0 +1,58 @@
+#pragma once
+
+#include <common/types.h>
+#include <common/attributes.h>
+#include <common/helpers.h>
+
+#ifdef ULTRA_ARCH_EXECUTION_MODE_X86_64
+
+#include <arch/private/msr.h>
+
+/*
+ * GS base holds the offset from the template to this CPU's copy, so any
+ * template address (including RIP-relative ones) with a GS override lands in
+ * the right copy.
+ */
+#define arch_this_cpu_read(var) ({                              \
+    typeof(var) __val;                                          \
+    asm volatile("mov %%gs:%1, %0" : "=q"(__val) : "m"(var));   \
+    __val;                                                      \
+})
+
+#define arch_this_cpu_write(var, val) do {                      \
+    typeof(var) __val = (val);                                  \
+    asm volatile("mov %1, %%gs:%0" : "=m"(var) : "q"(__val));   \
+} while (0)
+
+#define arch_this_cpu_add(var, val) do {                        \
+    typeof(var) __val = (val);                                  \
+    asm volatile("add %1, %%gs:%0" : "+m"(var) : "q"(__val)     \
+                 : "cc");                                       \
+} while (0)
+
+DECLARE_PER_CPU(ptr_t, g_this_cpu_offset);
+
+static ALWAYS_INLINE ptr_t arch_this_cpu_offset(void)
+{
+    return arch_this_cpu_read(g_this_cpu_offset);
+}
+
+static ALWAYS_INLINE void arch_percpu_activate(ptr_t offset)
+{
+    wrmsr(MSR_GS_BASE, offset);
+}
+
+#else
+
+// No SMP support in 32-bit mode, the bootstrap area is the only one
+static ALWAYS_INLINE ptr_t arch_this_cpu_offset(void)
+{
+    return g_percpu_offsets[0];
+}
+
+static ALWAYS_INLINE void arch_percpu_activate(ptr_t offset)
+{
+    UNREFERENCED_PARAMETER(offset);
+}
+
+#endif
@@ -21,6 +21,13 @@
 
 #define GP_REGS_END_OFFSET REG_AFTER(RDI_OFFSET)
 
+/*
+ * Layout of the lightweight frame built by the fast IRQ entry, which only
+ * saves the scratch registers in the same order as 'struct registers'.
+ */
+#define SCRATCH_OFFSET(x) ((x) - R11_OFFSET)
+#define SCRATCH_REGS_END_OFFSET SCRATCH_OFFSET(GP_REGS_END_OFFSET)
+
 #define AUX_OFFSET GP_REGS_END_OFFSET
 
 #define IRETQ_FRAME_OFFSET REG_AFTER(AUX_OFFSET)
@@ -34,15 +34,28 @@
 #define X86_EXCEPTION_RSVD reserved_exception
 
 #define X86_IRQ_DISPATCH irq_dispatch
+#define X86_IRQ_DISPATCH_FAST irq_dispatch_fast
 
 #define X86_IRQ_DISPATCH_ASM CONCAT(X86_IRQ_DISPATCH, _asm)
+#define X86_IRQ_DISPATCH_FAST_ASM CONCAT(X86_IRQ_DISPATCH_FAST, _asm)
 #define X86_EXCEPTION_RSVD_ASM CONCAT(handle_, CONCAT(X86_EXCEPTION_RSVD, _asm))
 
 #ifndef __ASSEMBLER__
 
+#include <common/types.h>
+
 #define EXCEPTION_HANDLER(x) void CONCAT(handle_, x)(struct registers *regs)
 #define IRQ_HANDLER void X86_IRQ_DISPATCH(struct registers *regs)
 
+// Invoked by the lightweight entry, only scratch registers are saved
+#define FAST_IRQ_HANDLER void X86_IRQ_DISPATCH_FAST(size_t irq_idx)
+
 void idt_init(void);
 
+/*
+ * Switches an IRQ vector between the full 'struct registers' entry path and
+ * the lightweight one that only preserves caller-clobbered registers.
+ */
+void idt_set_fast_irq_entry(u32 vector, bool fast);
+
 #endif
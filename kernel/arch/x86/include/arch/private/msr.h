@@ -0,0 +1,24 @@
+#pragma once
+
+#include <common/types.h>
+#include <common/attributes.h>
+
+#define MSR_APIC_BASE  0x1B
+#define MSR_X2APIC_EOI 0x80B
+#define MSR_X2APIC_SVR 0x80F
+#define MSR_X2APIC_ICR 0x830
+#define MSR_GS_BASE    0xC0000101
+
+static ALWAYS_INLINE u64 rdmsr(u32 msr)
+{
+    u32 lo, hi;
+
+    asm volatile("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((u64)hi << 32) | lo;
+}
+
+static ALWAYS_INLINE void wrmsr(u32 msr, u64 value)
+{
+    asm volatile("wrmsr" :: "c"(msr), "a"((u32)value), "d"((u32)(value >> 32))
+                 : "memory");
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// Picks between REP string and non-temporal page clear/copy
+void x86_page_ops_init(void);
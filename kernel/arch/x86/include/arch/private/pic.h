@@ -0,0 +1,4 @@
+#pragma once
+
+// Remaps the legacy 8259 PICs away from the exception vectors and masks them
+void x86_pic_disable(void);
@@ -0,0 +1,4 @@
+#pragma once
+
+// Picks the fastest memcpy()/memset() strategy supported by this CPU
+void x86_string_init(void);
@@ -0,0 +1,62 @@
+#include <common/types.h>
+#include <common/error.h>
+
+#include <private/arch/ipi.h>
+
+#include <arch/private/cpuid.h>
+#include <arch/private/msr.h>
+
+#define CPUID_1_ECX_X2APIC (1 << 21)
+
+#define APIC_BASE_X2APIC_ENABLE (1 << 10)
+#define APIC_BASE_ENABLE        (1 << 11)
+
+#define SVR_APIC_ENABLE (1 << 8)
+
+// Fixed delivery, physical destination, edge triggered
+#define ICR_FIXED_PHYSICAL 0
+
+/*
+ * APIC IDs are expected to match logical CPU indices, which is what SMP
+ * bring-up is going to configure.
+ */
+error_t arch_ipi_init(void)
+{
+    struct cpuid_res id;
+    u64 base;
+
+    cpuid(1, &id);
+    if (!(id.c & CPUID_1_ECX_X2APIC))
+        return ENODEV;
+
+    /*
+     * Going from a disabled local APIC straight to x2APIC mode is an invalid
+     * transition, enable xAPIC mode first if the firmware hasn't done so.
+     */
+    base = rdmsr(MSR_APIC_BASE);
+    if (!(base & APIC_BASE_ENABLE)) {
+        base |= APIC_BASE_ENABLE;
+        wrmsr(MSR_APIC_BASE, base);
+    }
+
+    if (!(base & APIC_BASE_X2APIC_ENABLE)) {
+        base |= APIC_BASE_X2APIC_ENABLE;
+        wrmsr(MSR_APIC_BASE, base);
+    }
+
+    // Software-enable the APIC, keeping the spurious vector as is
+    wrmsr(MSR_X2APIC_SVR, rdmsr(MSR_X2APIC_SVR) | SVR_APIC_ENABLE);
+    return EOK;
+}
+
+void arch_send_ipi(u32 cpu, u32 vector)
+{
+    u64 icr = ((u64)cpu << 32) | ICR_FIXED_PHYSICAL | (vector & 0xFF);
+
+    wrmsr(MSR_X2APIC_ICR, icr);
+}
+
+void arch_ack_ipi(void)
+{
+    wrmsr(MSR_X2APIC_EOI, 0);
+}
@@ -1,8 +1,236 @@
+#define MSG_FMT(msg) "irq: " msg
+
+#include <common/atomic.h>
+#include <common/helpers.h>
+#include <common/types.h>
+
+#include <irq.h>
 #include <log.h>
+#include <percpu.h>
+#include <smp.h>
 
 #include <arch/private/idt.h>
 #include <arch/registers.h>
 
+#define NUM_IRQ_VECTORS (NUM_IDT_ENTRIES - NUM_X86_EXCEPTIONS)
+#define IRQ_BITMAP_WORDS CEILING_DIVIDE(NUM_IRQ_VECTORS, 64)
+
+static struct irq_action *g_irq_actions[NUM_IRQ_VECTORS];
+static u64 g_irq_allocated[IRQ_BITMAP_WORDS];
+static DEFINE_PER_CPU(u64, g_irq_counts[NUM_IRQ_VECTORS]);
+
+/*
+ * Serializes (un)registration, the dispatch path never takes it and relies on
+ * actions being published with release semantics instead.
+ */
+static bool g_irq_lock;
+
+static void irq_lock(void)
+{
+    while (atomic_xchg(&g_irq_lock, true, MO_ACQUIRE));
+}
+
+static void irq_unlock(void)
+{
+    atomic_store_release(&g_irq_lock, false);
+}
+
+static bool vector_to_idx(u32 vector, size_t *out_idx)
+{
+    if (unlikely(vector < NUM_X86_EXCEPTIONS || vector >= NUM_IDT_ENTRIES))
+        return false;
+
+    *out_idx = vector - NUM_X86_EXCEPTIONS;
+    return true;
+}
+
+static bool g_irq_fast_entry[NUM_IRQ_VECTORS];
+
+/*
+ * Picks the entry path for the vector given its (new) list of actions. Must be
+ * called with the irq lock held, before publishing an action that needs the
+ * full register frame and after unpublishing one.
+ */
+static void idx_update_entry(size_t idx, struct irq_action *action)
+{
+    bool fast = action != NULL;
+
+    for (; action; action = action->next)
+        fast &= (action->flags & IRQ_FAST) != 0;
+
+    if (g_irq_fast_entry[idx] == fast)
+        return;
+
+    g_irq_fast_entry[idx] = fast;
+    idt_set_fast_irq_entry(idx + NUM_X86_EXCEPTIONS, fast);
+}
+
+static void idx_set_allocated(size_t idx, bool allocated)
+{
+    if (allocated)
+        g_irq_allocated[idx / 64] |= 1ull << (idx % 64);
+    else
+        g_irq_allocated[idx / 64] &= ~(1ull << (idx % 64));
+}
+
+MAYBE_NERR(int) irq_alloc_vector(void)
+{
+    size_t i;
+    int ret = -ENOSPC;
+
+    irq_lock();
+
+    for (i = 0; i < IRQ_BITMAP_WORDS; i++) {
+        u64 free_mask = ~g_irq_allocated[i];
+        size_t idx;
+
+        if (!free_mask)
+            continue;
+
+        idx = i * 64 + __builtin_ctzll(free_mask);
+        if (idx >= NUM_IRQ_VECTORS)
+            break;
+
+        idx_set_allocated(idx, true);
+        ret = idx + NUM_X86_EXCEPTIONS;
+        break;
+    }
+
+    irq_unlock();
+    return ret;
+}
+
+error_t irq_free_vector(u32 vector)
+{
+    size_t idx;
+    error_t ret = EOK;
+
+    if (!vector_to_idx(vector, &idx))
+        return EINVAL;
+
+    irq_lock();
+
+    if (g_irq_actions[idx] != NULL)
+        ret = EBUSY;
+    else
+        idx_set_allocated(idx, false);
+
+    irq_unlock();
+    return ret;
+}
+
+error_t irq_register(u32 vector, struct irq_action *action)
+{
+    struct irq_action *head;
+    size_t idx;
+    error_t ret = EOK;
+
+    if (!vector_to_idx(vector, &idx) || unlikely(action->handler == NULL))
+        return EINVAL;
+
+    irq_lock();
+
+    head = g_irq_actions[idx];
+    if (head != NULL &&
+        !((head->flags & action->flags) & IRQ_SHARED)) {
+        ret = EBUSY;
+        goto out;
+    }
+
+    action->next = head;
+    idx_set_allocated(idx, true);
+    idx_update_entry(idx, action);
+    atomic_store_release(&g_irq_actions[idx], action);
+
+out:
+    irq_unlock();
+    return ret;
+}
+
+error_t irq_unregister(u32 vector, struct irq_action *action)
+{
+    struct irq_action **link;
+    size_t idx;
+    error_t ret = ENOENT;
+
+    if (!vector_to_idx(vector, &idx))
+        return EINVAL;
+
+    irq_lock();
+
+    for (link = &g_irq_actions[idx]; *link; link = &(*link)->next) {
+        if (*link != action)
+            continue;
+
+        atomic_store_release(link, action->next);
+        idx_update_entry(idx, g_irq_actions[idx]);
+        ret = EOK;
+        break;
+    }
+
+    irq_unlock();
+    return ret;
+}
+
+u64 irq_get_count(u32 vector, u32 cpu)
+{
+    size_t idx;
+
+    if (!vector_to_idx(vector, &idx) || cpu >= smp_num_cpus())
+        return 0;
+
+    return atomic_load_relaxed(per_cpu_ptr(&g_irq_counts[idx], cpu));
+}
+
+void irq_dump_stats(void)
+{
+    struct irq_action *action;
+    size_t idx;
+    u32 cpu;
+    u64 count;
+
+    for (cpu = 0; cpu < smp_num_cpus(); cpu++) {
+        for (idx = 0; idx < NUM_IRQ_VECTORS; idx++) {
+            count = irq_get_count(idx + NUM_X86_EXCEPTIONS, cpu);
+            if (!count)
+                continue;
+
+            action = atomic_load_acquire(&g_irq_actions[idx]);
+            pr_info("CPU%u: vector %zu (%s) fired %llu times\n", cpu,
+                    idx + NUM_X86_EXCEPTIONS,
+                    action && action->name ? action->name : "<none>", count);
+        }
+    }
+}
+
+static void do_irq_dispatch(size_t idx, struct registers *regs)
+{
+    struct irq_action *action;
+    enum irq_return ret = IRQ_NONE;
+
+    irq_enter();
+    this_cpu_inc(g_irq_counts[idx]);
+
+    action = atomic_load_acquire(&g_irq_actions[idx]);
+
+    // Fast path: exactly one handler attached to this vector
+    if (likely(action != NULL && action->next == NULL)) {
+        ret = action->handler(regs, action->user);
+    } else {
+        for (; action; action = atomic_load_acquire(&action->next))
+            ret |= action->handler(regs, action->user);
+    }
+
+    if (unlikely(ret == IRQ_NONE))
+        pr_warn("Unexpected irq %zu\n", idx + NUM_X86_EXCEPTIONS);
+
+    irq_exit();
+}
+
 IRQ_HANDLER {
-    pr_warn("Unexpected irq %u\n", regs->interrupt_idx);
+    do_irq_dispatch(regs->interrupt_idx, regs);
+}
+
+FAST_IRQ_HANDLER {
+    do_irq_dispatch(irq_idx, NULL);
 }
@@ -0,0 +1,117 @@
+#define MSG_FMT(msg) "irq-bench: " msg
+
+#include <common/types.h>
+#include <common/error.h>
+#include <common/helpers.h>
+
+#include <irq.h>
+#include <log.h>
+#include <param.h>
+
+#include <arch/cycles.h>
+#include <arch/private/idt.h>
+
+/*
+ * Software interrupts only take an immediate vector, so the vector we get
+ * allocated is triggered via a table of "int $vector; ret" stubs instead.
+ */
+#define IRQ_BENCH_STUB_SIZE 4
+
+asm(
+    ".pushsection .text\n"
+    ".balign " TO_STR(IRQ_BENCH_STUB_SIZE) "\n"
+    "irq_bench_int_stubs:\n"
+    ".set irq_bench_vector, 0\n"
+    ".rept " TO_STR(NUM_IDT_ENTRIES) "\n"
+    ".byte 0xCD, irq_bench_vector, 0xC3, 0xCC\n"
+    ".set irq_bench_vector, irq_bench_vector + 1\n"
+    ".endr\n"
+    ".popsection\n"
+);
+extern const u8 irq_bench_int_stubs[];
+
+static u32 g_irq_bench;
+
+static enum irq_return irq_bench_handler(struct registers *regs, void *user)
+{
+    UNREFERENCED_PARAMETER(regs);
+
+    (*(u64*)user)++;
+    return IRQ_HANDLED;
+}
+
+static error_t irq_bench_run(u32 flags, u32 iterations, u64 *out_cycles)
+{
+    const u8 *stub;
+    u64 hits = 0, start;
+    u32 i;
+    int vector;
+    error_t ret;
+    struct irq_action action = {
+        .name = "irq-bench",
+        .handler = irq_bench_handler,
+        .user = &hits,
+        .flags = flags,
+    };
+
+    vector = irq_alloc_vector();
+    if (is_nerror(vector))
+        return -vector;
+
+    ret = irq_register(vector, &action);
+    if (is_error(ret))
+        goto out_free;
+
+    stub = &irq_bench_int_stubs[vector * IRQ_BENCH_STUB_SIZE];
+    start = arch_read_cycles();
+
+    for (i = 0; i < iterations; i++)
+        asm volatile("call *%0" :: "r"(stub) : "memory");
+
+    *out_cycles = (arch_read_cycles() - start) / iterations;
+
+    irq_unregister(vector, &action);
+    ret = hits == iterations ? EOK : EIO;
+
+out_free:
+    irq_free_vector(vector);
+    return ret;
+}
+
+/*
+ * Measures the average round-trip cost of an interrupt for both the full and
+ * the lightweight entry paths, enabled via irq_bench=<iterations>.
+ */
+static error_t irq_bench_set(struct string str, struct param *p)
+{
+    u64 full_cycles, fast_cycles;
+    error_t ret;
+
+    ret = param_set_u32(str, p);
+    if (is_error(ret) || !g_irq_bench)
+        return ret;
+
+    ret = irq_bench_run(0, g_irq_bench, &full_cycles);
+    if (is_error(ret))
+        goto out_err;
+
+    ret = irq_bench_run(IRQ_FAST, g_irq_bench, &fast_cycles);
+    if (is_error(ret))
+        goto out_err;
+
+    pr_info(
+        "%u iterations, round-trip: full frame %llu cycles, fast %llu cycles\n",
+        g_irq_bench, full_cycles, fast_cycles
+    );
+    return EOK;
+
+out_err:
+    pr_warn("benchmark failed: error %d\n", ret);
+    return ret;
+}
+
+static const struct param_ops g_irq_bench_ops = {
+    .set = irq_bench_set,
+    .get = param_get_u32,
+};
+early_parameter_with_ops(g_irq_bench, g_irq_bench_ops);
@@ -0,0 +1,50 @@
+#include <common/types.h>
+#include <common/attributes.h>
+
+#include <arch/private/pic.h>
+#include <arch/private/idt.h>
+
+#define PIC_MASTER_CMD  0x20
+#define PIC_MASTER_DATA 0x21
+#define PIC_SLAVE_CMD   0xA0
+#define PIC_SLAVE_DATA  0xA1
+
+#define ICW1_ICW4 (1 << 0)
+#define ICW1_INIT (1 << 4)
+#define ICW4_8086 (1 << 0)
+
+// The slave is cascaded through IRQ2 of the master
+#define PIC_CASCADE_IRQ 2
+
+static ALWAYS_INLINE void pic_write(u16 port, u8 value)
+{
+    asm volatile("outb %0, %1" :: "a"(value), "Nd"(port));
+
+    // Give old PICs time to react, port 0x80 is the POST code register
+    asm volatile("outb %%al, $0x80" ::: "memory");
+}
+
+/*
+ * Firmware leaves the PICs delivering IRQ0-15 at vectors 8-15 and 0x70-0x77
+ * where e.g. the timer would look like a double fault. Nothing in the kernel
+ * drives them, so move them on top of the first IRQ vectors and mask every
+ * line. A masked PIC can still raise a spurious IRQ7/IRQ15, which then shows
+ * up as an unexpected irq instead of an exception.
+ */
+void x86_pic_disable(void)
+{
+    pic_write(PIC_MASTER_CMD, ICW1_INIT | ICW1_ICW4);
+    pic_write(PIC_SLAVE_CMD, ICW1_INIT | ICW1_ICW4);
+
+    pic_write(PIC_MASTER_DATA, NUM_X86_EXCEPTIONS);
+    pic_write(PIC_SLAVE_DATA, NUM_X86_EXCEPTIONS + 8);
+
+    pic_write(PIC_MASTER_DATA, 1 << PIC_CASCADE_IRQ);
+    pic_write(PIC_SLAVE_DATA, PIC_CASCADE_IRQ);
+
+    pic_write(PIC_MASTER_DATA, ICW4_8086);
+    pic_write(PIC_SLAVE_DATA, ICW4_8086);
+
+    pic_write(PIC_MASTER_DATA, 0xFF);
+    pic_write(PIC_SLAVE_DATA, 0xFF);
+}
@@ -0,0 +1,86 @@
+#include <common/string.h>
+#include <common/types.h>
+
+#include <arch/private/cpuid.h>
+#include <arch/private/string.h>
+
+#undef memcpy
+#undef memmove
+#undef memset
+
+#define CPUID_MAX_LEAF 0
+#define CPUID_EXTENDED_FEATURES 7
+
+#define EXT_FEATURES_B_ERMS (1 << 9)
+#define EXT_FEATURES_D_FSRM (1 << 4)
+
+/*
+ * Enhanced REP MOVSB/STOSB makes string instructions the fastest way to move
+ * memory, but they still have a fixed startup cost that word loops win over
+ * for small sizes. Fast short REP MOV gets rid of that cost entirely.
+ */
+#define REP_STRING_THRESHOLD 128
+
+static size_t g_rep_string_threshold = SIZE_MAX;
+
+void x86_string_init(void)
+{
+    struct cpuid_res res;
+
+    cpuid(CPUID_MAX_LEAF, &res);
+    if (res.a < CPUID_EXTENDED_FEATURES)
+        return;
+
+    cpuid(CPUID_EXTENDED_FEATURES, &res);
+
+    if (res.d & EXT_FEATURES_D_FSRM)
+        g_rep_string_threshold = 0;
+    else if (res.b & EXT_FEATURES_B_ERMS)
+        g_rep_string_threshold = REP_STRING_THRESHOLD;
+}
+
+static inline void rep_movsb(void *dest, const void *src, size_t count)
+{
+    asm volatile("rep movsb"
+                 : "+D"(dest), "+S"(src), "+c"(count)
+                 :: "memory");
+}
+
+static inline void rep_stosb(void *dest, u8 value, size_t count)
+{
+    asm volatile("rep stosb"
+                 : "+D"(dest), "+c"(count)
+                 : "a"(value)
+                 : "memory");
+}
+
+void *memcpy(void *dest, const void *src, size_t count)
+{
+    if (count < g_rep_string_threshold)
+        return memcpy_generic(dest, src, count);
+
+    rep_movsb(dest, src, count);
+    return dest;
+}
+
+void *memmove(void *dest, const void *src, size_t count)
+{
+    /*
+     * REP MOVSB behaves like a byte-by-byte forward copy, so it's only usable
+     * if 'dest' doesn't start within 'src'. Backward string moves are slow on
+     * every CPU, leave those to the generic code.
+     */
+    if ((ptr_t)dest - (ptr_t)src >= count)
+        return memcpy(dest, src, count);
+
+    return memmove_generic(dest, src, count);
+}
+
+void *memset(void *dest, int ch, size_t count)
+{
+    if (count < g_rep_string_threshold)
+        return memset_generic(dest, ch, count);
+
+    rep_stosb(dest, ch, count);
+    return dest;
+}
@@ -6,10 +6,50 @@
 #undef memcmp
 #undef strlen
 
-void *memcpy(void *dest, const void *src, size_t count)
+/*
+ * Word-sized accesses that are allowed to alias anything, the unaligned
+ * variant is used for the source side which isn't necessarily aligned
+ * relative to the destination.
+ */
+typedef ptr_t __attribute__((may_alias)) word_t;
+typedef ptr_t __attribute__((may_alias, aligned(1))) unaligned_word_t;
+
+#define WORD_SIZE sizeof(word_t)
+#define WORD_MASK (WORD_SIZE - 1)
+
+// Below this size aligning the destination costs more than it saves
+#define WORD_COPY_THRESHOLD (WORD_SIZE * 2)
+
+void *memcpy_generic(void *dest, const void *src, size_t count)
 {
-    char *cd = dest;
-    const char *cs = src;
+    u8 *cd = dest;
+    const u8 *cs = src;
+
+    if (count >= WORD_COPY_THRESHOLD) {
+        for (; (ptr_t)cd & WORD_MASK; count--)
+            *cd++ = *cs++;
+
+        for (; count >= WORD_SIZE * 4; count -= WORD_SIZE * 4) {
+            word_t w0 = ((const unaligned_word_t*)cs)[0];
+            word_t w1 = ((const unaligned_word_t*)cs)[1];
+            word_t w2 = ((const unaligned_word_t*)cs)[2];
+            word_t w3 = ((const unaligned_word_t*)cs)[3];
+
+            ((word_t*)cd)[0] = w0;
+            ((word_t*)cd)[1] = w1;
+            ((word_t*)cd)[2] = w2;
+            ((word_t*)cd)[3] = w3;
+
+            cs += WORD_SIZE * 4;
+            cd += WORD_SIZE * 4;
+        }
+
+        for (; count >= WORD_SIZE; count -= WORD_SIZE) {
+            *(word_t*)cd = *(const unaligned_word_t*)cs;
+            cs += WORD_SIZE;
+            cd += WORD_SIZE;
+        }
+    }
 
     while (count--)
         *cd++ = *cs++;
@@ -17,44 +57,142 @@ void *memcpy(void *dest, const void *src, size_t count)
     return dest;
 }
 
-void *memmove(void *dest, const void *src, size_t count)
+/*
+ * Same as above but starting from the end, used when 'dest' overlaps the tail
+ * of 'src'. Every chunk is loaded before the store that could clobber it.
+ */
+static void *memcpy_backward_generic(void *dest, const void *src, size_t count)
 {
-    char *cd = dest;
-    const char *cs = src;
-
-    if (src < dest) {
-        cs += count;
-        cd += count;
+    u8 *cd = (u8*)dest + count;
+    const u8 *cs = (const u8*)src + count;
 
-        while (count--)
+    if (count >= WORD_COPY_THRESHOLD) {
+        for (; (ptr_t)cd & WORD_MASK; count--)
             *--cd = *--cs;
-    } else {
-        memcpy(dest, src, count);
+
+        for (; count >= WORD_SIZE * 4; count -= WORD_SIZE * 4) {
+            word_t w0, w1, w2, w3;
+
+            cs -= WORD_SIZE * 4;
+            cd -= WORD_SIZE * 4;
+
+            w3 = ((const unaligned_word_t*)cs)[3];
+            w2 = ((const unaligned_word_t*)cs)[2];
+            w1 = ((const unaligned_word_t*)cs)[1];
+            w0 = ((const unaligned_word_t*)cs)[0];
+
+            ((word_t*)cd)[3] = w3;
+            ((word_t*)cd)[2] = w2;
+            ((word_t*)cd)[1] = w1;
+            ((word_t*)cd)[0] = w0;
+        }
+
+        for (; count >= WORD_SIZE; count -= WORD_SIZE) {
+            cs -= WORD_SIZE;
+            cd -= WORD_SIZE;
+            *(word_t*)cd = *(const unaligned_word_t*)cs;
+        }
     }
 
+    while (count--)
+        *--cd = *--cs;
+
     return dest;
 }
 
-void *memset(void *dest, int ch, size_t count)
+void *memmove_generic(void *dest, const void *src, size_t count)
 {
-    unsigned char fill = ch;
-    unsigned char *cdest = dest;
+    // A forward copy is fine unless 'dest' starts within 'src'
+    if ((ptr_t)dest - (ptr_t)src >= count)
+        return memcpy_generic(dest, src, count);
+
+    return memcpy_backward_generic(dest, src, count);
+}
+
+void *memset_generic(void *dest, int ch, size_t count)
+{
+    u8 fill = ch;
+    u8 *cd = dest;
+
+    if (count >= WORD_COPY_THRESHOLD) {
+        word_t pattern = fill * ((word_t)-1 / 0xFF);
+
+        for (; (ptr_t)cd & WORD_MASK; count--)
+            *cd++ = fill;
+
+        for (; count >= WORD_SIZE * 4; count -= WORD_SIZE * 4) {
+            ((word_t*)cd)[0] = pattern;
+            ((word_t*)cd)[1] = pattern;
+            ((word_t*)cd)[2] = pattern;
+            ((word_t*)cd)[3] = pattern;
+            cd += WORD_SIZE * 4;
+        }
+
+        for (; count >= WORD_SIZE; count -= WORD_SIZE) {
+            *(word_t*)cd = pattern;
+            cd += WORD_SIZE;
+        }
+    }
 
     while (count--)
-        *cdest++ = fill;
+        *cd++ = fill;
 
     return dest;
 }
 
+#ifndef ULTRA_TEST
+
+// Architectures with faster ways to move memory around override these
+WEAK void *memcpy(void *dest, const void *src, size_t count)
+{
+    return memcpy_generic(dest, src, count);
+}
+
+WEAK void *memmove(void *dest, const void *src, size_t count)
+{
+    return memmove_generic(dest, src, count);
+}
+
+WEAK void *memset(void *dest, int ch, size_t count)
+{
+    return memset_generic(dest, ch, count);
+}
+
+#endif
+
+/*
+ * Word-at-a-time zero byte detection: a byte of 'x' that is zero borrows from
+ * its top bit when subtracting 0x01, while bytes that already had the top bit
+ * set are masked out by '~x'. Bytes above the first zero byte may produce
+ * false positives, which doesn't matter as only the lowest one is ever used.
+ */
+#define REPEAT_BYTE(x) ((word_t)-1 / 0xFF * (x))
+#define HAS_ZERO_BYTE(x) (((x) - REPEAT_BYTE(0x01)) & ~(x) & REPEAT_BYTE(0x80))
+
+// Offset of the first zero byte in a little-endian word with one present
+static inline size_t first_zero_byte(word_t mask)
+{
+    return __builtin_ctzl((unsigned long)mask) / 8;
+}
+
 int memcmp(const void *lhs, const void *rhs, size_t count)
 {
     const u8 *byte_lhs = lhs;
     const u8 *byte_rhs = rhs;
-    size_t i;
 
-    for (i = 0; i < count; ++i) {
-        if (byte_lhs[i] != byte_rhs[i])
-            return byte_lhs[i] - byte_rhs[i];
+    for (; count >= WORD_SIZE; count -= WORD_SIZE) {
+        if (*(const unaligned_word_t*)byte_lhs !=
+            *(const unaligned_word_t*)byte_rhs)
+            break;
+
+        byte_lhs += WORD_SIZE;
+        byte_rhs += WORD_SIZE;
+    }
+
+    // Either the tail or the first mismatching word, find the exact byte
+    for (; count; count--, byte_lhs++, byte_rhs++) {
+        if (*byte_lhs != *byte_rhs)
+            return *byte_lhs - *byte_rhs;
     }
 
     return 0;
@@ -62,9 +200,24 @@ int memcmp(const void *lhs, const void *rhs, size_t count)
 
 size_t strlen(const char *str)
 {
-    const char *str1;
+    const char *str1 = str;
+    const word_t *word;
+    word_t mask;
+
+    for (; (ptr_t)str1 & WORD_MASK; str1++) {
+        if (!*str1)
+            return str1 - str;
+    }
 
-    for (str1 = str; *str1; str1++);
+    /*
+     * Aligned loads never cross into the next page, so reading a few bytes
+     * past the terminator is harmless.
+     */
+    for (word = (const word_t*)str1;; word++) {
+        mask = HAS_ZERO_BYTE(*word);
+        if (mask)
+            break;
+    }
 
-    return str1 - str;
+    return ((const char*)word - str) + first_zero_byte(mask);
 }
@@ -1,19 +1,14 @@
 #include <common/string_container.h>
 #include <common/ctype.h>
+#include <common/minmax.h>
+#include <common/string.h>
 
 bool str_equals(struct string lhs, struct string rhs)
 {
-    size_t i;
-
     if (lhs.size != rhs.size)
         return false;
 
-    for (i = 0; i < lhs.size; ++i) {
-        if (lhs.text[i] != rhs.text[i])
-            return false;
-    }
-
-    return true;
+    return memcmp(lhs.text, rhs.text, lhs.size) == 0;
 }
 
 bool str_equals_with_cb(
@@ -36,19 +31,10 @@ bool str_equals_with_cb(
 
 bool str_starts_with(struct string str, struct string prefix)
 {
-    size_t i;
-
     if (prefix.size > str.size)
         return false;
-    if (prefix.size == 0)
-        return true;
-
-    for (i = 0; i < prefix.size; ++i) {
-        if (str.text[i] != prefix.text[i])
-            return false;
-    }
 
-    return true;
+    return memcmp(str.text, prefix.text, prefix.size) == 0;
 }
 
 ssize_t str_find_with_cb(
@@ -69,9 +55,44 @@ ssize_t str_find_with_cb(
     return -1;
 }
 
+/*
+ * Short needles or haystacks are matched by scanning for the first character
+ * of the needle, building the skip table costs more than it saves there.
+ */
+#define STR_FIND_MIN_NEEDLE 4
+#define STR_FIND_MIN_HAYSTACK 64
+
+// Skip distances are capped to what fits into a byte, which is still correct
+#define STR_FIND_MAX_SKIP 255u
+
+static ssize_t str_find_short(struct string str, struct string needle,
+                              size_t starting_at)
+{
+    size_t i, last = str.size - needle.size;
+    ssize_t idx;
+
+    for (i = starting_at; i <= last; i = idx + 1) {
+        idx = str_find_one(str, needle.text[0], i);
+        if (idx < 0 || (size_t)idx > last)
+            break;
+
+        if (memcmp(str.text + idx + 1, needle.text + 1, needle.size - 1) == 0)
+            return idx;
+    }
+
+    return -1;
+}
+
+/*
+ * Boyer-Moore-Horspool: compare the last character of the window first, and
+ * on mismatch shift by the distance from that character's last occurrence in
+ * the needle to the end of the needle.
+ */
 ssize_t str_find(struct string str, struct string needle, size_t starting_at)
 {
-    size_t i, j, k;
+    u8 skip[256];
+    size_t i, last_idx, default_skip;
+    char last_char;
 
     BUG_ON(starting_at > str.size);
 
@@ -79,23 +100,26 @@ ssize_t str_find(struct string str, struct string needle, size_t starting_at)
         return -1;
     if (str_empty(needle))
         return starting_at;
+    if (needle.size < STR_FIND_MIN_NEEDLE ||
+        str.size - starting_at < STR_FIND_MIN_HAYSTACK)
+        return str_find_short(str, needle, starting_at);
 
-    for (i = starting_at; i < str.size - needle.size + 1; ++i) {
-        if (str.text[i] != needle.text[0])
-            continue;
-
-        j = i;
-        k = 0;
+    last_idx = needle.size - 1;
+    last_char = needle.text[last_idx];
+    default_skip = MIN(needle.size, STR_FIND_MAX_SKIP);
 
-        while (k < needle.size) {
-            if (str.text[j++] != needle.text[k])
-                break;
+    memset(skip, default_skip, sizeof(skip));
+    for (i = 0; i < last_idx; i++)
+        skip[(u8)needle.text[i]] = MIN(last_idx - i, STR_FIND_MAX_SKIP);
 
-            k++;
-        }
+    for (i = starting_at; i <= str.size - needle.size;) {
+        char c = str.text[i + last_idx];
 
-        if (k == needle.size)
+        if (c == last_char &&
+            memcmp(str.text + i, needle.text, last_idx) == 0)
             return i;
+
+        i += skip[(u8)c];
     }
 
     return -1;
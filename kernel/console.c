@@ -1,7 +1,50 @@
+#define MSG_FMT(msg) "console: " msg
+
+#include <common/atomic.h>
+#include <common/format.h>
+
 #include <console.h>
+#include <log.h>
+#include <softirq.h>
+
+#include <private/log.h>
+
+/*
+ * Size of the buffer records are batched into before being handed to a
+ * console. Every console gets at most one batch per round, so that a slow
+ * console lags behind without holding up the rest.
+ */
+#define CONSOLE_BATCH_SIZE (4 * LOG_LINE_MAX)
 
 static struct console *consoles;
 
+/*
+ * Held by whoever is writing to the consoles or modifying the console list,
+ * producers never wait for it.
+ */
+static bool g_console_owner;
+
+/*
+ * Set by contexts that want the consoles flushed, the owner checks it before
+ * returning so that nobody's records are left stranded behind a busy owner.
+ */
+static bool g_console_flush_requested;
+
+static bool console_trylock(void)
+{
+    return !atomic_xchg(&g_console_owner, true, MO_ACQUIRE);
+}
+
+static void console_lock(void)
+{
+    while (!console_trylock());
+}
+
+static void console_unlock(void)
+{
+    atomic_store_release(&g_console_owner, false);
+}
+
 static bool console_registered(struct console *con)
 {
     struct console *this_con;
@@ -16,23 +59,32 @@ static bool console_registered(struct console *con)
 
 error_t register_console(struct console *con)
 {
-    if (!consoles) {
-        consoles = con;
-        return EOK;
-    }
+    error_t ret = EOK;
 
-    if (console_registered(con))
-        return EBUSY;
+    console_lock();
 
+    if (console_registered(con)) {
+        ret = EBUSY;
+        goto out;
+    }
+
+    con->seq = log_first_seq();
+    con->dropped = 0;
     con->next = consoles;
     consoles = con;
-    return EOK;
+
+out:
+    console_unlock();
+    return ret;
 }
 
 error_t unregister_console(struct console *con)
 {
     struct console *cur_con;
     struct console *prev_con = NULL;
+    error_t ret = EINVAL;
+
+    console_lock();
 
     for (cur_con = consoles; cur_con; cur_con = cur_con->next) {
         if (cur_con != con) {
@@ -42,10 +94,15 @@ error_t unregister_console(struct console *con)
 
         if (prev_con)
             prev_con->next = cur_con->next;
-        return EOK;
+        else
+            consoles = cur_con->next;
+
+        ret = EOK;
+        break;
     }
 
-    return EINVAL;
+    console_unlock();
+    return ret;
 }
 
 void console_write(const char *str, size_t count)
@@ -55,3 +112,123 @@ void console_write(const char *str, size_t count)
     for (con = consoles; con; con = con->next)
         con->write(con, str, count);
 }
+
+/*
+ * Writes out at most one batch worth of records to the console. Returns true
+ * if the console made progress and has more records left, false if it either
+ * caught up or is waiting for a record that is yet to be committed. In the
+ * latter case the producer raises SOFTIRQ_LOG once it commits.
+ */
+static bool console_flush_one(struct console *con, char *batch)
+{
+    struct log_record rec;
+    enum log_read_result res;
+    size_t used = 0;
+    u64 lost = 0, start_seq = con->seq;
+
+    // Records are read straight into the batch, so keep room for a full one
+    while (CONSOLE_BATCH_SIZE - used >= LOG_LINE_MAX) {
+        res = log_read(&con->seq, &rec, batch + used, &lost);
+        if (res == LOG_READ_EMPTY)
+            break;
+        if (res == LOG_READ_OK)
+            used += rec.text_len;
+    }
+
+    if (lost) {
+        con->dropped += lost;
+        used += scnprintf(
+            batch + used, CONSOLE_BATCH_SIZE - used,
+            "** %llu log messages dropped **\n", lost
+        );
+    }
+
+    if (used)
+        con->write(con, batch, used);
+
+    return con->seq != start_seq && con->seq < log_next_seq();
+}
+
+/*
+ * Gives every console one batch per round, either until no console is able
+ * to make progress ('drain') or for a single round. Returns true if there are
+ * records left that could be written right away.
+ */
+static bool console_flush_locked(bool drain)
+{
+    static char batch[CONSOLE_BATCH_SIZE];
+    struct console *con;
+    bool more;
+
+    do {
+        more = false;
+
+        for (con = consoles; con; con = con->next)
+            more |= console_flush_one(con, batch);
+    } while (drain && more);
+
+    return more;
+}
+
+static bool console_do_flush(bool drain)
+{
+    bool more;
+
+    for (;;) {
+        atomic_store_relaxed(&g_console_flush_requested, true);
+        barrier_full();
+
+        // The owner is going to see our request before it leaves
+        if (!console_trylock())
+            return false;
+
+        atomic_store_relaxed(&g_console_flush_requested, false);
+        more = console_flush_locked(drain);
+        console_unlock();
+
+        /*
+         * Someone might have committed a record and found the consoles busy
+         * after we were done reading, take care of it on their behalf.
+         */
+        barrier_full();
+        if (!atomic_load_relaxed(&g_console_flush_requested))
+            return more;
+        if (!drain)
+            return true;
+    }
+}
+
+void console_flush(void)
+{
+    console_do_flush(true);
+}
+
+void console_flush_deferred(void)
+{
+    if (console_do_flush(false))
+        softirq_raise(SOFTIRQ_LOG);
+}
+
+void console_force_flush(void)
+{
+    atomic_store_release(&g_console_owner, true);
+    console_flush_locked(true);
+    console_unlock();
+}
+
+void console_dump_stats(void)
+{
+    struct console *con;
+
+    console_lock();
+
+    for (con = consoles; con; con = con->next) {
+        pr_info(
+            "%s: at seq %llu, %llu records dropped\n",
+            con->name, con->seq, con->dropped
+        );
+    }
+
+    console_unlock();
+    console_flush();
+}
@@ -8,11 +8,17 @@
 #include <boot/ultra_protocol.h>
 
 #include <initcall.h>
+#include <irq.h>
 #include <log.h>
 #include <bug.h>
 #include <boot/alloc.h>
 #include <param.h>
+#include <percpu.h>
+#include <softirq.h>
+#include <smp_call.h>
 
+#include <private/fb_console.h>
+#include <private/log.h>
 #include <private/unwind.h>
 #include <private/param.h>
 #include <private/arch/init.h>
@@ -76,6 +82,35 @@ static void boot_context_init(struct ultra_boot_context *ctx)
     );
 }
 
+/*
+ * Print interrupt and deferred work statistics gathered during boot right
+ * before going idle.
+ */
+static bool g_boot_stats;
+early_parameter(g_boot_stats);
+
+static void dump_boot_stats(void)
+{
+    irq_dump_stats();
+    softirq_dump_stats();
+    smp_call_dump_stats();
+}
+
+NORETURN
+static void idle_loop(void)
+{
+    log_enable_deferred_output();
+
+    for (;;) {
+        local_irq_disable();
+        softirq_run_pending();
+
+        // Anything raised from now on comes from an interrupt that wakes us up
+        if (!softirq_pending())
+            local_irq_enable_and_wait();
+    }
+}
+
 static const char *platform_type_to_string(u32 type)
 {
     switch (type) {
@@ -93,6 +128,8 @@ void entry(struct ultra_boot_context *ctx)
     struct ultra_platform_info_attribute *pi;
     error_t ret;
 
+    percpu_init();
+
     print(
         "Starting ultra kernel v0.0.1 on %s (@%s, built on %s %s)\n",
         ULTRA_ARCH_EXECUTION_MODE_STRING, ULTRA_GIT_SHA, __DATE__, __TIME__
@@ -129,5 +166,16 @@ void entry(struct ultra_boot_context *ctx)
 
     boot_alloc_init();
 
-    for (;;);
+    ret = fb_console_init();
+    if (is_error(ret))
+        pr_warn("fb_console_init() error %d, framebuffer console disabled\n", ret);
+
+    ret = smp_call_init();
+    if (is_error(ret))
+        pr_warn("smp_call_init() error %d, cross-CPU calls unavailable\n", ret);
+
+    if (g_boot_stats)
+        dump_boot_stats();
+
+    idle_loop();
 }
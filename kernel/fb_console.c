@@ -0,0 +1,404 @@
+#define MSG_FMT(msg) "fbcon: " msg
+
+#include <common/align.h>
+#include <common/helpers.h>
+#include <common/minmax.h>
+#include <common/string.h>
+#include <common/types.h>
+
+#include <boot/alloc.h>
+#include <boot/boot.h>
+#include <console.h>
+#include <font.h>
+#include <io.h>
+#include <log.h>
+
+#include <private/fb_console.h>
+
+#define FBCON_FG_COLOR 0xAAAAAA
+
+/*
+ * Background is always black, which is all zeroes in every supported format,
+ * so clearing is a plain memset of the shadow buffer.
+ */
+#define FBCON_BG_COLOR 0x000000
+
+#define FBCON_TAB_WIDTH 8
+
+// Displays at least this wide get glyphs scaled up 2x to stay readable
+#define FBCON_SCALE_THRESHOLD 2560
+
+struct fb_console {
+    const struct font *font;
+    u16 format;
+
+    u8 *fb;
+    u32 pitch;
+    u32 width;
+    u32 height;
+    u8 bytes_per_pixel;
+
+    /*
+     * Everything is rendered into the shadow buffer first, which has the same
+     * layout as the framebuffer minus any padding at the end of the rows. The
+     * framebuffer is slow to read (or even write) in small chunks, so it is
+     * only ever written with wide stores from here.
+     */
+    u8 *shadow;
+    u32 shadow_pitch;
+
+    /*
+     * Every printable character pre-rendered in the framebuffer pixel format,
+     * drawing a character is then just a copy of 'cell_height' rows.
+     */
+    u8 *glyph_cache;
+    u32 glyph_size;
+    u32 cell_pitch;
+
+    u32 cell_width;
+    u32 cell_height;
+    u32 cols;
+    u32 rows;
+
+    u32 cursor_x;
+    u32 cursor_y;
+
+    // Area to flush to the framebuffer in cells, [x0, x1) x [y0, y1)
+    u32 dirty_x0, dirty_y0;
+    u32 dirty_x1, dirty_y1;
+
+    struct console con;
+};
+
+static struct fb_console g_fbcon;
+
+static u8 format_to_bytes_per_pixel(u16 format)
+{
+    switch (format) {
+    case ULTRA_FB_FORMAT_RGB888:
+    case ULTRA_FB_FORMAT_BGR888:
+        return 3;
+    case ULTRA_FB_FORMAT_RGBX8888:
+    case ULTRA_FB_FORMAT_XRGB8888:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+// Formats are named from the most significant byte of a little-endian pixel
+static void encode_pixel(u16 format, u32 rgb, u8 *out)
+{
+    u8 r = rgb >> 16, g = rgb >> 8, b = rgb;
+
+    switch (format) {
+    case ULTRA_FB_FORMAT_RGB888:
+        out[0] = b;
+        out[1] = g;
+        out[2] = r;
+        break;
+    case ULTRA_FB_FORMAT_BGR888:
+        out[0] = r;
+        out[1] = g;
+        out[2] = b;
+        break;
+    case ULTRA_FB_FORMAT_RGBX8888:
+        out[0] = 0;
+        out[1] = b;
+        out[2] = g;
+        out[3] = r;
+        break;
+    case ULTRA_FB_FORMAT_XRGB8888:
+        out[0] = b;
+        out[1] = g;
+        out[2] = r;
+        out[3] = 0;
+        break;
+    }
+}
+
+static void fbcon_build_glyph_cache(struct fb_console *fbc, u32 scale)
+{
+    const struct font *font = fbc->font;
+    u8 fg[4], bg[4];
+    u8 *out = fbc->glyph_cache;
+    u32 c, x, y;
+
+    encode_pixel(fbc->format, FBCON_FG_COLOR, fg);
+    encode_pixel(fbc->format, FBCON_BG_COLOR, bg);
+
+    for (c = font->first_char; c <= font->last_char; c++) {
+        const u8 *glyph = font_glyph(font, c);
+
+        for (y = 0; y < fbc->cell_height; y++) {
+            u8 bits = glyph[y / scale];
+
+            for (x = 0; x < fbc->cell_width; x++) {
+                bool set = bits & (1 << (x / scale));
+
+                memcpy(out, set ? fg : bg, fbc->bytes_per_pixel);
+                out += fbc->bytes_per_pixel;
+            }
+        }
+    }
+}
+
+static u8 *fbcon_shadow_cell(struct fb_console *fbc, u32 x, u32 y)
+{
+    return fbc->shadow + (y * fbc->cell_height * fbc->shadow_pitch) +
+           (x * fbc->cell_pitch);
+}
+
+static void fbcon_mark_dirty(struct fb_console *fbc, u32 x0, u32 y0,
+                             u32 x1, u32 y1)
+{
+    fbc->dirty_x0 = MIN(fbc->dirty_x0, x0);
+    fbc->dirty_y0 = MIN(fbc->dirty_y0, y0);
+    fbc->dirty_x1 = MAX(fbc->dirty_x1, x1);
+    fbc->dirty_y1 = MAX(fbc->dirty_y1, y1);
+}
+
+static void fbcon_reset_dirty(struct fb_console *fbc)
+{
+    fbc->dirty_x0 = fbc->cols;
+    fbc->dirty_y0 = fbc->rows;
+    fbc->dirty_x1 = 0;
+    fbc->dirty_y1 = 0;
+}
+
+static void fbcon_draw_char(struct fb_console *fbc, char c)
+{
+    const u8 *src;
+    u8 *dst;
+    u32 i, idx = (u8)c;
+
+    if (idx < fbc->font->first_char || idx > fbc->font->last_char)
+        idx = '?';
+
+    src = fbc->glyph_cache + (idx - fbc->font->first_char) * fbc->glyph_size;
+    dst = fbcon_shadow_cell(fbc, fbc->cursor_x, fbc->cursor_y);
+
+    for (i = 0; i < fbc->cell_height; i++) {
+        memcpy(dst, src, fbc->cell_pitch);
+        src += fbc->cell_pitch;
+        dst += fbc->shadow_pitch;
+    }
+
+    fbcon_mark_dirty(fbc, fbc->cursor_x, fbc->cursor_y,
+                     fbc->cursor_x + 1, fbc->cursor_y + 1);
+}
+
+static void fbcon_scroll(struct fb_console *fbc)
+{
+    size_t line_bytes = fbc->cell_height * fbc->shadow_pitch;
+
+    memmove(fbc->shadow, fbc->shadow + line_bytes,
+            (fbc->rows - 1) * line_bytes);
+    memzero(fbcon_shadow_cell(fbc, 0, fbc->rows - 1), line_bytes);
+
+    // Every line has moved, so the whole screen has to be flushed anyway
+    fbcon_mark_dirty(fbc, 0, 0, fbc->cols, fbc->rows);
+}
+
+static void fbcon_newline(struct fb_console *fbc)
+{
+    fbc->cursor_x = 0;
+
+    if (fbc->cursor_y + 1 < fbc->rows) {
+        fbc->cursor_y++;
+        return;
+    }
+
+    fbcon_scroll(fbc);
+}
+
+static void fbcon_putc(struct fb_console *fbc, char c)
+{
+    switch (c) {
+    case '\n':
+        fbcon_newline(fbc);
+        return;
+    case '\r':
+        fbc->cursor_x = 0;
+        return;
+    case '\t':
+        fbc->cursor_x = ALIGN_UP(fbc->cursor_x + 1, FBCON_TAB_WIDTH);
+        if (fbc->cursor_x >= fbc->cols)
+            fbcon_newline(fbc);
+        return;
+    default:
+        break;
+    }
+
+    if (fbc->cursor_x >= fbc->cols)
+        fbcon_newline(fbc);
+
+    fbcon_draw_char(fbc, c);
+    fbc->cursor_x++;
+}
+
+/*
+ * Copies one row segment to the framebuffer using 8-byte stores for the
+ * aligned part. Stores are volatile so that the compiler doesn't turn this
+ * back into a memcpy() call or split them up.
+ */
+static void fbcon_blit_row(u8 *dst, const u8 *src, size_t bytes)
+{
+    volatile u8 *dst8 = dst;
+    volatile u64 *dst64;
+
+    while (bytes && !IS_ALIGNED((ptr_t)dst8, sizeof(u64))) {
+        *dst8++ = *src++;
+        bytes--;
+    }
+
+    for (dst64 = (volatile u64*)dst8; bytes >= sizeof(u64);
+         bytes -= sizeof(u64), src += sizeof(u64)) {
+        u64 word;
+
+        memcpy(&word, src, sizeof(word));
+        *dst64++ = word;
+    }
+
+    for (dst8 = (volatile u8*)dst64; bytes; bytes--)
+        *dst8++ = *src++;
+}
+
+static void fbcon_flush(struct fb_console *fbc)
+{
+    u32 y, y_end;
+    size_t x_offset, bytes;
+
+    if (fbc->dirty_x0 >= fbc->dirty_x1 || fbc->dirty_y0 >= fbc->dirty_y1)
+        return;
+
+    x_offset = fbc->dirty_x0 * fbc->cell_pitch;
+    bytes = (fbc->dirty_x1 - fbc->dirty_x0) * fbc->cell_pitch;
+    y_end = fbc->dirty_y1 * fbc->cell_height;
+
+    for (y = fbc->dirty_y0 * fbc->cell_height; y < y_end; y++) {
+        fbcon_blit_row(
+            fbc->fb + (y * fbc->pitch) + x_offset,
+            fbc->shadow + (y * fbc->shadow_pitch) + x_offset,
+            bytes
+        );
+    }
+
+    fbcon_reset_dirty(fbc);
+}
+
+static void fbcon_write(struct console *con, const char *str, size_t count)
+{
+    struct fb_console *fbc = container_of(con, struct fb_console, con);
+    size_t i;
+
+    for (i = 0; i < count; i++)
+        fbcon_putc(fbc, str[i]);
+
+    fbcon_flush(fbc);
+}
+
+static void *fbcon_alloc(size_t bytes)
+{
+    phys_addr_t phys;
+
+    phys = boot_alloc(PAGE_ROUND_UP(bytes) >> PAGE_SHIFT);
+    if (error_phys_addr(phys))
+        return NULL;
+
+    return phys_to_virt(phys);
+}
+
+static void fbcon_free(void *ptr, size_t bytes)
+{
+    if (ptr)
+        boot_free(virt_to_phys(ptr), PAGE_ROUND_UP(bytes) >> PAGE_SHIFT);
+}
+
+/*
+ * The direct map can't reach past the end of the address space, on 32-bit
+ * that's well below where framebuffers usually live.
+ */
+static bool fbcon_in_direct_map(phys_addr_t phys, u64 length)
+{
+    u64 limit = (ptr_t)-1 - g_direct_map_base;
+
+    return length && phys <= limit && length - 1 <= limit - phys;
+}
+
+error_t fb_console_init(void)
+{
+    struct ultra_framebuffer *fb;
+    struct fb_console *fbc = &g_fbcon;
+    u32 scale = 1;
+    size_t cache_size, shadow_size;
+
+    if (!g_boot_ctx.fb)
+        return EOK;
+
+    fb = &g_boot_ctx.fb->fb;
+    fbc->font = &g_font8x8;
+    fbc->format = fb->format;
+    fbc->bytes_per_pixel = format_to_bytes_per_pixel(fb->format);
+
+    if (!fbc->bytes_per_pixel || fbc->bytes_per_pixel * 8 != fb->bpp) {
+        pr_warn("unsupported framebuffer format %u (%u bpp)\n",
+                fb->format, fb->bpp);
+        return EINVAL;
+    }
+
+    if (!fbcon_in_direct_map(fb->physical_address,
+                             (u64)fb->pitch * fb->height)) {
+        pr_warn("framebuffer at 0x%016llX is not in the direct map\n",
+                (u64)fb->physical_address);
+        return ENOTSUP;
+    }
+
+    if (fb->width >= FBCON_SCALE_THRESHOLD)
+        scale = 2;
+
+    fbc->width = fb->width;
+    fbc->height = fb->height;
+    fbc->pitch = fb->pitch;
+    fbc->cell_width = fbc->font->width * scale;
+    fbc->cell_height = fbc->font->height * scale;
+    fbc->cols = fbc->width / fbc->cell_width;
+    fbc->rows = fbc->height / fbc->cell_height;
+    if (!fbc->cols || !fbc->rows)
+        return EINVAL;
+
+    fbc->cell_pitch = fbc->cell_width * fbc->bytes_per_pixel;
+    fbc->glyph_size = fbc->cell_pitch * fbc->cell_height;
+    fbc->shadow_pitch = fbc->width * fbc->bytes_per_pixel;
+
+    cache_size = fbc->font->last_char - fbc->font->first_char + 1;
+    cache_size *= fbc->glyph_size;
+    fbc->glyph_cache = fbcon_alloc(cache_size);
+
+    shadow_size = (size_t)fbc->shadow_pitch * fbc->rows * fbc->cell_height;
+    fbc->shadow = fbcon_alloc(shadow_size);
+
+    if (!fbc->glyph_cache || !fbc->shadow) {
+        fbcon_free(fbc->glyph_cache, cache_size);
+        fbcon_free(fbc->shadow, shadow_size);
+        return ENOMEM;
+    }
+
+    fbc->fb = phys_to_virt(fb->physical_address);
+
+    fbcon_build_glyph_cache(fbc, scale);
+    memzero(fbc->shadow, shadow_size);
+
+    // Start from a clean screen, whatever the loader left there is gone
+    fbcon_reset_dirty(fbc);
+    fbcon_mark_dirty(fbc, 0, 0, fbc->cols, fbc->rows);
+    fbcon_flush(fbc);
+
+    fbc->con.name = "framebuffer";
+    fbc->con.write = fbcon_write;
+
+    pr_info("%ux%u, %ux%u cells of %ux%u\n", fbc->width, fbc->height,
+            fbc->cols, fbc->rows, fbc->cell_width, fbc->cell_height);
+
+    return register_console(&fbc->con);
+}
@@ -6,10 +6,77 @@
 #include <common/types.h>
 #include <common/error.h>
 
+/*
+ * Destination for formatted output. The formatter writes into 'buf' and calls
+ * 'flush' whenever it fills up, as well as once at the end if anything is
+ * left, which must consume the first 'used' bytes of 'buf'. Sinks without a
+ * flush callback silently drop everything past 'capacity' instead.
+ *
+ * Callback sinks normally point 'buf' at a small on-stack chunk, sinks that
+ * know where the output ends up can point it straight at the destination.
+ */
+struct fmt_sink {
+    char *buf;
+    size_t capacity;
+    size_t used;
+
+    void (*flush)(struct fmt_sink*);
+};
+
+/*
+ * On top of the standard integer, %c and %s conversions the following pointer
+ * extensions are supported:
+ *     %pS - a 'struct string*', printed up to its size
+ *     %pF - a code address, printed as symbol+offset
+ *     %pB - a return address as found in a backtrace, the symbol is resolved
+ *           from the preceding byte so calls at the very end of a function
+ *           are attributed correctly
+ * Addresses that can't be resolved are printed as raw hex values.
+ */
+
+/*
+ * Formats into 'sink', returns the length of the entire output regardless of
+ * how much of it the sink has taken, or a negative error code.
+ */
+MAYBE_NERR(int) vcbprintf(
+    struct fmt_sink *sink, const char *fmt, va_list vlist
+);
+
+// Same as vcbprintf, with arguments as described for vsnprintf_array
+MAYBE_NERR(int) vcbprintf_array(
+    struct fmt_sink *sink, const char *fmt,
+    const u64 *array, size_t array_size
+);
+
+PRINTF_DECL(2, 3)
+static inline MAYBE_NERR(int) cbprintf(
+    struct fmt_sink *sink, const char *fmt, ...
+)
+{
+    va_list list;
+    int written;
+    va_start(list, fmt);
+    written = vcbprintf(sink, fmt, list);
+    va_end(list);
+
+    return written;
+}
+
 MAYBE_NERR(int) vsnprintf(
     char *restrict buffer, size_t capacity, const char *fmt, va_list vlist
 );
 
+/*
+ * Same as vsnprintf, except arguments are taken from an array of raw words,
+ * one per argument, as captured by e.g. trace_printk(). Integers are expected
+ * to be converted to u64, pointers to ptr_t. Returns -EINVAL if the format
+ * consumes more arguments than provided.
+ */
+MAYBE_NERR(int) vsnprintf_array(
+    char *restrict buffer, size_t capacity, const char *fmt,
+    const u64 *array, size_t array_size
+);
+
 static inline MAYBE_NERR(int) vscnprintf(
     char *restrict buffer, size_t capacity, const char *fmt, va_list vlist
 )
@@ -9,6 +9,14 @@
 #define memcmp __builtin_memcmp
 #define strlen __builtin_strlen
 
+/*
+ * Portable word-at-a-time implementations, the actual memcpy() and friends
+ * may be overridden by the architecture.
+ */
+void *memcpy_generic(void *dest, const void *src, size_t count);
+void *memmove_generic(void *dest, const void *src, size_t count);
+void *memset_generic(void *dest, int ch, size_t count);
+
 static ALWAYS_INLINE void *memzero(void *dest, size_t count)
 {
     return memset(dest, 0, count);
@@ -7,10 +7,42 @@ struct console {
     void (*write)(struct console *con, const char *str, size_t count);
     void *priv;
 
+    // Managed by the console code
     struct console *next;
+
+    // Sequence number of the next log record to write out
+    u64 seq;
+
+    // Records that were overwritten before this console got to them
+    u64 dropped;
 };
 
+/*
+ * Registered consoles start off by replaying whatever is still present in the
+ * log, then each one follows the log at its own pace.
+ */
 error_t register_console(struct console *con);
 error_t unregister_console(struct console *con);
 
 void console_write(const char *str, size_t count);
+
+/*
+ * Writes out pending log records to every console, batching as many records
+ * as possible into a single write() call. Stops early at a record that is yet
+ * to be committed, its producer schedules another flush once it's done. If
+ * another context is already writing to the consoles, returns immediately as
+ * that context is going to pick up any records committed before the call.
+ */
+void console_flush(void);
+
+/*
+ * The SOFTIRQ_LOG handler, writes out one batch per console and raises the
+ * softirq again if any of them has more left. Slow consoles thus catch up
+ * over several runs instead of holding up whoever is processing softirqs.
+ */
+void console_flush_deferred(void);
+
+// Same as console_flush(), but ignores any other context that might be flushing
+void console_force_flush(void);
+
+void console_dump_stats(void);
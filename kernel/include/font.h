@@ -0,0 +1,30 @@
+#pragma once
+
+#include <common/types.h>
+
+/*
+ * Monochrome bitmap font, every glyph is 'height' bytes with one byte per row
+ * and the leftmost pixel in the least significant bit.
+ */
+struct font {
+    u8 width;
+    u8 height;
+
+    // Range of characters covered by 'glyphs', inclusive
+    u8 first_char;
+    u8 last_char;
+
+    const u8 *glyphs;
+};
+
+static inline const u8 *font_glyph(const struct font *font, char c)
+{
+    u8 idx = c;
+
+    if (idx < font->first_char || idx > font->last_char)
+        idx = '?';
+
+    return &font->glyphs[(idx - font->first_char) * font->height];
+}
+
+extern const struct font g_font8x8;
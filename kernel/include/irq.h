@@ -0,0 +1,108 @@
+#pragma once
+
+#include <common/types.h>
+#include <common/error.h>
+#include <common/attributes.h>
+
+#include <arch/irq_flags.h>
+
+// Defined in arch/registers.h
+struct registers;
+
+enum irq_return {
+    IRQ_NONE    = 0,
+    IRQ_HANDLED = 1,
+};
+
+typedef enum irq_return (*irq_handler_t)(struct registers*, void *user);
+
+enum irq_flags {
+    // Allow other actions with the same flag to share the vector
+    IRQ_SHARED = 1 << 0,
+
+    /*
+     * The handler doesn't need the interrupted register state and is invoked
+     * with a NULL 'struct registers'. A vector whose actions all set this flag
+     * uses a lightweight entry path that only saves caller-clobbered registers.
+     */
+    IRQ_FAST   = 1 << 1,
+};
+
+/*
+ * Storage for a registered interrupt handler, owned by the caller and must
+ * stay alive until the action is unregistered.
+ */
+struct irq_action {
+    const char *name;
+    irq_handler_t handler;
+    void *user;
+    u32 flags;
+
+    struct irq_action *next;
+};
+
+/*
+ * Allocates an unused interrupt vector, returns the vector number or a
+ * negative error code if no vectors are available.
+ */
+MAYBE_NERR(int) irq_alloc_vector(void);
+error_t irq_free_vector(u32 vector);
+
+/*
+ * Attaches an action to the specified vector, the vector is implicitly marked
+ * as allocated. Must not be called from interrupt context.
+ */
+error_t irq_register(u32 vector, struct irq_action*);
+error_t irq_unregister(u32 vector, struct irq_action*);
+
+// Number of times 'vector' has fired on 'cpu'
+u64 irq_get_count(u32 vector, u32 cpu);
+
+// Prints the per-CPU counts of every vector that has fired at least once
+void irq_dump_stats(void);
+
+static ALWAYS_INLINE void local_irq_enable(void)
+{
+    arch_irq_enable();
+}
+
+static ALWAYS_INLINE void local_irq_disable(void)
+{
+    arch_irq_disable();
+}
+
+/*
+ * Enables interrupts and halts this CPU until the next one arrives. Must be
+ * called with interrupts disabled, an interrupt that comes in between the two
+ * still ends the wait.
+ */
+static ALWAYS_INLINE void local_irq_enable_and_wait(void)
+{
+    arch_irq_enable_and_wait();
+}
+
+// Disables interrupts on this CPU, returns the previous state
+static ALWAYS_INLINE ptr_t local_irq_save(void)
+{
+    return arch_irq_save();
+}
+
+static ALWAYS_INLINE void local_irq_restore(ptr_t flags)
+{
+    arch_irq_restore(flags);
+}
+
+/*
+ * Must bracket every hardware interrupt handler invocation, irq_exit() runs
+ * any pending deferred work once the outermost interrupt returns.
+ */
+void irq_enter(void);
+void irq_exit(void);
+
+bool in_hardirq(void);
+bool in_softirq(void);
+
+static inline bool in_interrupt(void)
+{
+    return in_hardirq() || in_softirq();
+}
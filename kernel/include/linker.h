@@ -13,3 +13,4 @@
 
 #define EARLY_PARAMETERS_SECTION early_parameters
 #define PARAMETERS_SECTION parameters
+#define PERCPU_SECTION percpu
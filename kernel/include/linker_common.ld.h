@@ -42,13 +42,29 @@
     *(.eh_frame)                       \
     LINKER_SYMBOL(eh_frame_end) = .;
 
-#define DATA \
-    *(.data) \
+/*
+ * The per-CPU template, never accessed directly. Every CPU, including the
+ * bootstrap one, gets a private copy at boot.
+ */
+#define PERCPU                        \
+    . = ALIGN(64);                    \
+    MARKED_SECTION(PERCPU_SECTION)
+
+// Statically reserved per-CPU area of the bootstrap processor
+#define PERCPU_BSP_AREA                                                      \
+    . = ALIGN(64);                                                           \
+    LINKER_SYMBOL(percpu_bsp_area) = .;                                      \
+    . += SECTION_ARRAY_END(PERCPU_SECTION) - SECTION_ARRAY_BEGIN(PERCPU_SECTION);
+
+#define DATA   \
+    PERCPU     \
+    *(.data)   \
     *(.data.*)
 
-#define BSS        \
-    *(COMMON)      \
-    *(.bss .bss.*)
+#define BSS             \
+    *(COMMON)           \
+    *(.bss .bss.*)      \
+    PERCPU_BSP_AREA
 
 #define SECTION_TABS                     \
     .symtab : { *(.symtab) }             \
@@ -2,6 +2,7 @@
 
 #include <common/attributes.h>
 #include <common/helpers.h>
+#include <common/types.h>
 
 #include <stdarg.h>
 
@@ -44,6 +45,26 @@ enum log_level {
 #define LOG_INFO    LOG_LEVEL_PREFIX TO_STR(SYSLOG_INFO)
 #define LOG_DEBUG   LOG_LEVEL_PREFIX TO_STR(SYSLOG_DEBUG)
 
+// Maximum length of a single log record, longer messages are truncated
+#define LOG_LINE_MAX 1024
+
+struct log_record {
+    u64 seq;
+
+    // Raw cycle counter value at the time of logging
+    u64 timestamp;
+
+    enum log_level level;
+    u32 cpu;
+    size_t text_len;
+};
+
+/*
+ * Records the message in the log and returns, the consoles pick it up later
+ * from a softirq. Use console_flush() for output that is needed right away.
+ * Early in boot, before softirqs are processed, task context writes the
+ * message out synchronously instead.
+ */
 void vprint(const char *msg, va_list vlist);
 
 PRINTF_DECL(1, 2)
@@ -70,3 +91,4 @@ struct registers;
  * specified in registers with the provided log_level
  */
 void dump_stack(enum log_level, struct registers*);
+
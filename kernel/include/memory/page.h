@@ -0,0 +1,12 @@
+#pragma once
+
+#include <common/types.h>
+
+/*
+ * Zeroes or copies exactly one naturally aligned page. Unlike memset() and
+ * memcpy() these may bypass the cache, the data written is assumed not to be
+ * needed by the CPU again soon, e.g. freshly zeroed allocations or the target
+ * of a copy-on-write.
+ */
+void clear_page(void *page);
+void copy_page(void *dest, const void *src);
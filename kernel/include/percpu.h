@@ -0,0 +1,55 @@
+#pragma once
+
+#include <common/types.h>
+#include <common/error.h>
+#include <common/attributes.h>
+
+#include <linker.h>
+
+/*
+ * Per-CPU variables. These live in a template section that is replicated for
+ * every CPU at boot, the accessors below always operate on the copy belonging
+ * to the CPU executing the code. The caller is responsible for not migrating
+ * between CPUs in the middle of a read-modify-write sequence spanning several
+ * accessors, e.g. by disabling interrupts.
+ */
+#define DEFINE_PER_CPU(type, name) SECTION_VAR(PERCPU_SECTION, , type) name
+#define DECLARE_PER_CPU(type, name) extern type name
+
+// Offset from the template to the per-CPU copy, indexed by CPU number
+extern ptr_t g_percpu_offsets[];
+
+#define per_cpu_ptr(ptr, cpu) \
+    ((typeof(ptr))((ptr_t)(ptr) + g_percpu_offsets[cpu]))
+#define per_cpu(var, cpu) (*per_cpu_ptr(&(var), cpu))
+
+#include <arch/percpu.h>
+
+#define this_cpu_ptr(ptr) \
+    ((typeof(ptr))((ptr_t)(ptr) + arch_this_cpu_offset()))
+
+/*
+ * Architectures that are able to address the per-CPU area in a single
+ * instruction provide their own scalar accessors.
+ */
+#ifndef arch_this_cpu_read
+#define arch_this_cpu_read(var) (*this_cpu_ptr(&(var)))
+#define arch_this_cpu_write(var, val) (*this_cpu_ptr(&(var)) = (val))
+#define arch_this_cpu_add(var, val) (*this_cpu_ptr(&(var)) += (val))
+#endif
+
+#define this_cpu_read(var) arch_this_cpu_read(var)
+#define this_cpu_write(var, val) arch_this_cpu_write(var, val)
+#define this_cpu_add(var, val) arch_this_cpu_add(var, val)
+#define this_cpu_inc(var) this_cpu_add(var, 1)
+
+DECLARE_PER_CPU(u32, g_this_cpu_id);
+
+/*
+ * Sets up and activates the per-CPU area of the bootstrap processor, must be
+ * called before anything touches a per-CPU variable.
+ */
+void percpu_init(void);
+
+// Allocates and initializes the per-CPU area for a secondary CPU
+error_t percpu_alloc_cpu(u32 cpu);
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <common/types.h>
+#include <common/error.h>
+
+/*
+ * Prepares this CPU for sending and receiving IPIs, returns ENODEV if the
+ * architecture or the machine doesn't support them.
+ */
+error_t arch_ipi_init(void);
+
+// Sends a fixed interrupt 'vector' to the specified logical CPU
+void arch_send_ipi(u32 cpu, u32 vector);
+
+// Signals the end of IPI handling, must be called by the IPI handler
+void arch_ack_ipi(void);
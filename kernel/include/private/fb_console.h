@@ -0,0 +1,9 @@
+#pragma once
+
+#include <common/error.h>
+
+/*
+ * Registers a text console on top of the boot framebuffer, if one was
+ * provided by the loader. Must be called after the boot allocator is up.
+ */
+error_t fb_console_init(void);
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <common/error.h>
+#include <common/string_container.h>
+
+#include <log.h>
+
+/*
+ * Messages above the level are dropped before being formatted. Per-module
+ * levels take precedence and match messages starting with "<module>: ", the
+ * module string must stay alive for as long as the override is active.
+ */
+error_t log_set_level(enum log_level);
+error_t log_set_module_level(struct string module, enum log_level);
+
+/*
+ * Stops task context producers from writing to the consoles themselves, from
+ * now on records are only written out from the SOFTIRQ_LOG handler. Meant to
+ * be called once softirqs are guaranteed to run, e.g. from the idle loop.
+ */
+void log_enable_deferred_output(void);
+
+enum log_read_result {
+    LOG_READ_OK,
+    LOG_READ_EMPTY,
+    LOG_READ_LOST,
+};
+
+/*
+ * Copies out the record at '*seq' along with its text (up to LOG_LINE_MAX
+ * bytes, not null-terminated) and advances it. Records that have been
+ * overwritten in the meantime are skipped and added to '*lost'.
+ */
+enum log_read_result log_read(
+    u64 *seq, struct log_record*, char *text, u64 *lost
+);
+
+// Sequence number of the oldest record still in the log
+u64 log_first_seq(void);
+
+// Sequence number the next record is going to get
+u64 log_next_seq(void);
@@ -14,11 +14,13 @@ extern const u32 g_symbol_count;
 extern const u8 g_symbol_compressed_names[];
 
 /*
- * An array of 'g_symbol_count' / 256 entries, where each entry specifies the
- * offset into 'g_symbol_compressed_names' where the name at index & 0xFF can
- * be found. This makes name from index lookup O(1) instead of O(N).
+ * An array of 'g_symbol_count' >> 'g_symbol_name_offset_shift' entries (rounded
+ * up), where entry N specifies the offset into 'g_symbol_compressed_names' of
+ * the name at index N << 'g_symbol_name_offset_shift'. Finding a name by index
+ * then only has to skip at most (1 << 'g_symbol_name_offset_shift') - 1 names.
  */
 extern const u32 g_symbol_name_offsets[];
+extern const u32 g_symbol_name_offset_shift;
 
 /*
  * An array of 256 null-terminated ASCII strings that make up the kernel
@@ -42,6 +44,18 @@ extern const u16 g_symbol_token_offsets[];
 extern const u32 g_symbol_relative_addresses[];
 extern const ptr_t g_symbol_base;
 
+/*
+ * An array of 'g_symbol_address_index_size' entries, one per
+ * (1 << 'g_symbol_address_index_shift') bytes of address space starting at
+ * 'g_symbol_base'. Entry N is the index of the last symbol that starts at or
+ * before the beginning of its page, so any address within page N belongs to
+ * a symbol in the range [entry N, entry N + 1], narrowing the binary search
+ * down to a handful of symbols.
+ */
+extern const u32 g_symbol_address_index[];
+extern const u32 g_symbol_address_index_size;
+extern const u32 g_symbol_address_index_shift;
+
 /*
  * An array of 'g_symbol_count' 3-byte indices of names sorted in
  * lexicographical order that map names to their respective index in
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <common/types.h>
+
+#include <arch/private/unwind.h>
+
+/*
+ * Call frame information pre-evaluated from .eh_frame at build time by
+ * scripts/generate_unwind_tables.py. Frames covered by the table are unwound
+ * with a binary search and a few loads, anything else goes through the DWARF
+ * interpreter.
+ */
+
+// Marks a range of .text that is not covered by the table
+#define UNWIND_TABLE_NO_RULE 0xFFFF
+
+struct unwind_table_rule {
+    // CFA = frame[cfa_reg] + cfa_offset
+    i32 cfa_offset;
+    u8 cfa_reg;
+    u8 ret_reg;
+
+    /*
+     * CFA-relative offset in bytes at which each register of the caller is
+     * saved, 0 if the register keeps its value.
+     */
+    i16 reg_offsets[ARCH_NUM_DWARF_REGISTERS];
+};
+
+/*
+ * Number of DWARF registers the table was generated for, the table is
+ * ignored unless this matches ARCH_NUM_DWARF_REGISTERS.
+ */
+extern const u32 g_unwind_table_num_registers;
+
+/*
+ * An array of 'g_unwind_table_size' offsets from the start of .text sorted
+ * in ascending order. The rule at the same index in
+ * 'g_unwind_table_rule_indices' applies from that offset up to the next one,
+ * either an index into 'g_unwind_table_rules' or UNWIND_TABLE_NO_RULE.
+ */
+extern const u32 g_unwind_table_pcs[];
+extern const u16 g_unwind_table_rule_indices[];
+extern const u32 g_unwind_table_size;
+
+// Unique rules referenced by 'g_unwind_table_rule_indices'
+extern const struct unwind_table_rule g_unwind_table_rules[];
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <common/types.h>
+#include <common/attributes.h>
+
+#include <percpu.h>
+
+#include <arch/processor.h>
+
+// Maximum number of CPUs the kernel is able to manage
+#define MAX_CPUS 64
+
+// Index of the CPU executing this code
+static ALWAYS_INLINE u32 smp_processor_id(void)
+{
+    return this_cpu_read(g_this_cpu_id);
+}
+
+// Number of CPUs that are currently online
+static inline u32 smp_num_cpus(void)
+{
+    return 1;
+}
+
+// Hint to the CPU that we're spinning on a condition
+static ALWAYS_INLINE void cpu_relax(void)
+{
+    arch_cpu_relax();
+}
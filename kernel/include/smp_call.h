@@ -0,0 +1,59 @@
+#pragma once
+
+#include <common/atomic.h>
+#include <common/types.h>
+#include <common/error.h>
+
+/*
+ * Cross-CPU function calls. Calls are pushed onto a lock-free queue owned by
+ * the target CPU, which is kicked with an IPI only if its queue was empty.
+ * Any number of calls queued before the target gets around to draining the
+ * queue are thus delivered with a single interrupt.
+ */
+typedef void (*smp_call_func_t)(void *arg);
+
+struct smp_call {
+    smp_call_func_t func;
+    void *arg;
+
+    // Managed by the cross-call code
+    struct smp_call *next;
+    bool done;
+};
+
+/*
+ * Queues 'call' to be run on 'cpu' and returns immediately. The storage is
+ * owned by the caller and must stay alive until smp_call_is_done() returns
+ * true. Calls targeting the current CPU are run immediately.
+ */
+error_t smp_call_async(u32 cpu, struct smp_call*);
+
+static inline bool smp_call_is_done(struct smp_call *call)
+{
+    return atomic_load_acquire(&call->done);
+}
+
+void smp_call_wait(struct smp_call*);
+
+/*
+ * Runs 'func' on 'cpu' and waits for it to complete. Must not be called with
+ * interrupts disabled, as the target might be waiting for us in turn.
+ */
+error_t smp_call_sync(u32 cpu, smp_call_func_t func, void *arg);
+
+struct smp_call_stats {
+    // Sender side
+    u64 calls_queued;
+    u64 ipis_sent;
+    u64 ipis_coalesced;
+
+    // Receiver side
+    u64 calls_executed;
+    u64 ipis_received;
+};
+
+void smp_call_get_stats(u32 cpu, struct smp_call_stats*);
+void smp_call_dump_stats(void);
+
+// Allocates the IPI vector, must be called once before any cross-CPU call
+error_t smp_call_init(void);
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <common/types.h>
+
+/*
+ * Deferred interrupt work ("bottom halves"). Hard interrupt handlers raise a
+ * softirq to postpone the bulk of their processing, which then runs with
+ * interrupts enabled once the outermost interrupt returns. Each CPU has its
+ * own pending mask, so a softirq always runs on the CPU that raised it.
+ */
+enum softirq_type {
+    SOFTIRQ_TASKLET,
+    SOFTIRQ_LOG,
+    SOFTIRQ_COUNT,
+};
+
+typedef void (*softirq_handler_t)(void);
+
+void softirq_register(enum softirq_type, softirq_handler_t);
+
+/*
+ * May be called from any context, including hard interrupt handlers. Raising
+ * a softirq that has no handler registered is a no-op and warns.
+ */
+void softirq_raise(enum softirq_type);
+
+/*
+ * Runs softirqs left pending on this CPU, e.g. because irq_exit() exhausted
+ * its restart budget. Meant to be invoked from the idle loop.
+ */
+void softirq_run_pending(void);
+
+// Whether this CPU has any softirqs pending, must be called with irqs disabled
+bool softirq_pending(void);
+
+struct tasklet {
+    void (*func)(struct tasklet*);
+
+    // Managed by the softirq code
+    struct tasklet *next;
+    bool scheduled;
+};
+
+/*
+ * Queues a tasklet to run once on this CPU. Scheduling an already scheduled
+ * tasklet is a no-op, so multiple events are naturally batched together.
+ */
+void tasklet_schedule(struct tasklet*);
+
+struct softirq_stats {
+    // Cycles spent in hard interrupt handlers and deferred handlers
+    u64 hardirq_cycles;
+    u64 softirq_cycles;
+
+    u64 hardirq_count;
+    u64 runs[SOFTIRQ_COUNT];
+};
+
+void softirq_get_stats(u32 cpu, struct softirq_stats*);
+void softirq_dump_stats(void);
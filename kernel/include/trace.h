@@ -0,0 +1,83 @@
+#pragma once
+
+#include <common/attributes.h>
+#include <common/helpers.h>
+#include <common/types.h>
+
+/*
+ * Deferred-format tracing. trace_printk() only records the format string
+ * pointer and the raw argument words into a per-CPU ring, the actual
+ * formatting happens once the buffer is dumped. This makes it cheap enough
+ * to be used in interrupt handlers and other hot paths.
+ *
+ * Since only pointers are recorded, the format string and any %s or %pS
+ * arguments must point to storage that outlives the trace buffer, e.g.
+ * string literals.
+ */
+#define TRACE_MAX_ARGS 6
+
+void trace_record(const char *fmt, const u64 *args, size_t num_args);
+
+// Writes out the contents of every CPU's trace buffer to the kernel log
+void trace_dump(void);
+
+// Never called, only used for compile-time format checking
+PRINTF_DECL(1, 2)
+static inline void trace_printk_check(const char *fmt, ...)
+{
+    UNREFERENCED_PARAMETER(fmt);
+}
+
+static ALWAYS_INLINE u64 trace_arg_integer(u64 x)
+{
+    return x;
+}
+
+static ALWAYS_INLINE u64 trace_arg_pointer(const volatile void *x)
+{
+    return (ptr_t)x;
+}
+
+/*
+ * Integers are widened to u64 directly, so that 64-bit values survive on
+ * architectures with 32-bit pointers, everything else is recorded as a
+ * pointer.
+ */
+#define TRACE_ARG(x) _Generic((x),                \
+    _Bool: trace_arg_integer,                     \
+    char: trace_arg_integer,                      \
+    signed char: trace_arg_integer,               \
+    unsigned char: trace_arg_integer,             \
+    short: trace_arg_integer,                     \
+    unsigned short: trace_arg_integer,            \
+    int: trace_arg_integer,                       \
+    unsigned int: trace_arg_integer,              \
+    long: trace_arg_integer,                      \
+    unsigned long: trace_arg_integer,             \
+    long long: trace_arg_integer,                 \
+    unsigned long long: trace_arg_integer,        \
+    default: trace_arg_pointer                    \
+)(x)
+
+#define TRACE_ARGS_0()
+#define TRACE_ARGS_1(a) TRACE_ARG(a)
+#define TRACE_ARGS_2(a, ...) TRACE_ARG(a), TRACE_ARGS_1(__VA_ARGS__)
+#define TRACE_ARGS_3(a, ...) TRACE_ARG(a), TRACE_ARGS_2(__VA_ARGS__)
+#define TRACE_ARGS_4(a, ...) TRACE_ARG(a), TRACE_ARGS_3(__VA_ARGS__)
+#define TRACE_ARGS_5(a, ...) TRACE_ARG(a), TRACE_ARGS_4(__VA_ARGS__)
+#define TRACE_ARGS_6(a, ...) TRACE_ARG(a), TRACE_ARGS_5(__VA_ARGS__)
+
+#define TRACE_DO_NUM_ARGS(_0, _1, _2, _3, _4, _5, _6, n, ...) n
+#define TRACE_NUM_ARGS(...) \
+    TRACE_DO_NUM_ARGS(_, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+
+#define trace_printk(fmt, ...) do {                                      \
+    u64 __trace_args[TRACE_MAX_ARGS] = {                                 \
+        CONCAT(TRACE_ARGS_, TRACE_NUM_ARGS(__VA_ARGS__))(__VA_ARGS__)    \
+    };                                                                   \
+                                                                         \
+    if (0)                                                               \
+        trace_printk_check(fmt, ##__VA_ARGS__);                          \
+                                                                         \
+    trace_record(fmt, __trace_args, TRACE_NUM_ARGS(__VA_ARGS__));        \
+} while (0)
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <common/types.h>
+#include <common/error.h>
+
+#include <console.h>
+#include <io.h>
+
+struct uart_16550 {
+    io_window *iow;
+    u32 baud;
+
+    // Number of bytes that can be written at once after THR goes empty
+    size_t fifo_size;
+
+    struct console con;
+};
+
+/*
+ * Probes and programs the UART at 'iow' for 8N1 at the specified baud rate
+ * with the FIFO enabled and interrupts disabled. Output is polled, one FIFO
+ * worth of data per wait for the transmitter to drain.
+ */
+error_t uart_16550_init(struct uart_16550*, io_window *iow, u32 baud);
@@ -0,0 +1,48 @@
+#include <common/attributes.h>
+#include <common/error.h>
+#include <common/helpers.h>
+#include <common/types.h>
+
+#include <irq.h>
+
+/*
+ * NOTE:
+ * Below are generic implementations for architectures that don't manage
+ * interrupt vectors (yet), every allocation or registration attempt fails.
+ */
+
+WEAK MAYBE_NERR(int) irq_alloc_vector(void)
+{
+    return -ENOSYS;
+}
+
+WEAK error_t irq_free_vector(u32 vector)
+{
+    UNREFERENCED_PARAMETER(vector);
+    return ENOSYS;
+}
+
+WEAK error_t irq_register(u32 vector, struct irq_action *action)
+{
+    UNREFERENCED_PARAMETER(vector);
+    UNREFERENCED_PARAMETER(action);
+    return ENOSYS;
+}
+
+WEAK error_t irq_unregister(u32 vector, struct irq_action *action)
+{
+    UNREFERENCED_PARAMETER(vector);
+    UNREFERENCED_PARAMETER(action);
+    return ENOSYS;
+}
+
+WEAK u64 irq_get_count(u32 vector, u32 cpu)
+{
+    UNREFERENCED_PARAMETER(vector);
+    UNREFERENCED_PARAMETER(cpu);
+    return 0;
+}
+
+WEAK void irq_dump_stats(void)
+{
+}
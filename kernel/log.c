@@ -1,12 +1,202 @@
+#include <common/align.h>
+#include <common/atomic.h>
+#include <common/conversions.h>
 #include <common/helpers.h>
 #include <common/format.h>
 #include <common/error.h>
+#include <common/string.h>
+#include <common/string_container.h>
 
 #include <console.h>
+#include <irq.h>
 #include <log.h>
-#include <symbols.h>
+#include <param.h>
+#include <percpu.h>
+#include <smp.h>
+#include <softirq.h>
 #include <unwind.h>
 
+#include <private/log.h>
+
+#include <arch/cycles.h>
+
+/*
+ * The log is a lock-free multi-producer ring made of two parts: a ring of
+ * fixed size record descriptors indexed by sequence number, and a ring of
+ * text data the descriptors point into. Producers reserve a sequence number
+ * and LOG_LINE_MAX bytes of text with atomic operations, format straight into
+ * the reserved text, give back whatever they didn't use and commit the
+ * descriptor. Old records are silently overwritten, readers detect that by
+ * re-validating the descriptor and the text range after copying them out.
+ */
+#define LOG_DESC_COUNT 1024
+#define LOG_DATA_SIZE (64 * 1024)
+
+struct log_desc {
+    /*
+     * (seq << 1) | committed, written last with release semantics by the
+     * producer that owns 'seq'.
+     */
+    u64 state;
+
+    u64 timestamp;
+    u64 data_begin;
+    u16 text_len;
+    u16 cpu;
+    u8 level;
+};
+
+static struct log_desc g_log_descs[LOG_DESC_COUNT];
+static char g_log_data[LOG_DATA_SIZE];
+
+// Next sequence number and text position to hand out
+static u64 g_log_seq_head;
+static u64 g_log_data_head;
+
+#define DESC_STATE(seq, committed) (((seq) << 1) | (committed))
+#define DESC_STATE_SEQ(state) ((state) >> 1)
+#define DESC_STATE_COMMITTED(state) ((state) & 1)
+
+static struct log_desc *seq_to_desc(u64 seq)
+{
+    return &g_log_descs[seq % LOG_DESC_COUNT];
+}
+
+// Text ranges never wrap, they're moved to the start of the ring instead
+static u64 log_data_reserve(size_t len)
+{
+    u64 begin, head = atomic_load_relaxed(&g_log_data_head);
+
+    do {
+        begin = head;
+
+        if ((begin % LOG_DATA_SIZE) + len > LOG_DATA_SIZE)
+            begin = ALIGN_UP(begin, LOG_DATA_SIZE);
+    } while (!atomic_cmpxchg_explicit(&g_log_data_head, head, begin + len,
+                                      MO_RELAXED, MO_RELAXED));
+
+    return begin;
+}
+
+/*
+ * Returns unused text at the end of a reservation, only possible if nobody
+ * has reserved anything after it in the meantime. Otherwise the space stays
+ * unused until the ring wraps around.
+ */
+static void log_data_trim(u64 begin, size_t reserved, size_t used)
+{
+    u64 head = begin + reserved;
+
+    atomic_cmpxchg_explicit(&g_log_data_head, head, begin + used,
+                            MO_RELAXED, MO_RELAXED);
+}
+
+static void log_vstore(enum log_level level, const char *msg, va_list vlist)
+{
+    struct log_desc *desc;
+    struct fmt_sink sink;
+    u64 seq, begin;
+    int chars;
+
+    seq = atomic_add_fetch(&g_log_seq_head, 1, MO_RELAXED) - 1;
+    begin = log_data_reserve(LOG_LINE_MAX);
+    desc = seq_to_desc(seq);
+
+    atomic_store_relaxed(&desc->state, DESC_STATE(seq, 0));
+    barrier_release();
+
+    // Anything past LOG_LINE_MAX is truncated
+    sink = (struct fmt_sink) {
+        .buf = &g_log_data[begin % LOG_DATA_SIZE],
+        .capacity = LOG_LINE_MAX,
+    };
+    chars = vcbprintf(&sink, msg, vlist);
+    if (unlikely(chars < 0))
+        sink.used = 0;
+
+    log_data_trim(begin, LOG_LINE_MAX, sink.used);
+
+    desc->timestamp = arch_read_cycles();
+    desc->data_begin = begin;
+    desc->text_len = sink.used;
+    desc->cpu = smp_processor_id();
+    desc->level = level;
+
+    atomic_store_release(&desc->state, DESC_STATE(seq, 1));
+}
+
+enum log_read_result log_read(
+    u64 *seq, struct log_record *out_rec, char *buf, u64 *out_lost
+)
+{
+    struct log_desc *desc;
+    u64 state, head, begin;
+    size_t len;
+
+    head = atomic_load_acquire(&g_log_seq_head);
+    if (*seq >= head)
+        return LOG_READ_EMPTY;
+
+    if (head - *seq > LOG_DESC_COUNT) {
+        *out_lost += head - LOG_DESC_COUNT - *seq;
+        *seq = head - LOG_DESC_COUNT;
+        return LOG_READ_LOST;
+    }
+
+    desc = seq_to_desc(*seq);
+    state = atomic_load_acquire(&desc->state);
+
+    // Still being written by its producer
+    if (state != DESC_STATE(*seq, 1) &&
+        DESC_STATE_SEQ(state) <= *seq)
+        return LOG_READ_EMPTY;
+
+    if (state != DESC_STATE(*seq, 1))
+        goto out_lost;
+
+    begin = desc->data_begin;
+    len = desc->text_len;
+
+    // Torn by a producer that lapped us while we were reading the fields
+    if (unlikely(len > LOG_LINE_MAX ||
+                 (begin % LOG_DATA_SIZE) + len > LOG_DATA_SIZE))
+        goto out_lost;
+
+    out_rec->seq = *seq;
+    out_rec->timestamp = desc->timestamp;
+    out_rec->level = desc->level;
+    out_rec->cpu = desc->cpu;
+    out_rec->text_len = len;
+    memcpy(buf, &g_log_data[begin % LOG_DATA_SIZE], len);
+
+    barrier_acquire();
+
+    // Make sure neither the descriptor nor the text got recycled under us
+    if (atomic_load_relaxed(&desc->state) != state ||
+        atomic_load_relaxed(&g_log_data_head) > begin + LOG_DATA_SIZE)
+        goto out_lost;
+
+    (*seq)++;
+    return LOG_READ_OK;
+
+out_lost:
+    (*out_lost)++;
+    (*seq)++;
+    return LOG_READ_LOST;
+}
+
+u64 log_first_seq(void)
+{
+    u64 head = atomic_load_acquire(&g_log_seq_head);
+
+    return head > LOG_DESC_COUNT ? head - LOG_DESC_COUNT : 0;
+}
+
+u64 log_next_seq(void)
+{
+    return atomic_load_acquire(&g_log_seq_head);
+}
+
 static size_t extract_msg_level(const char *msg, enum log_level *out_level)
 {
     u8 level;
@@ -23,22 +213,160 @@ static size_t extract_msg_level(const char *msg, enum log_level *out_level)
     return 2;
 }
 
+/*
+ * Messages with a level above this are dropped before being formatted, can be
+ * overridden for individual modules identified by their MSG_FMT prefix.
+ */
+static u8 g_loglevel = LOG_LEVEL_INFO;
+
+#define LOG_MAX_MODULE_LEVELS 16
+
+struct log_module_level {
+    struct string name;
+    enum log_level level;
+};
+
+static struct log_module_level g_log_module_levels[LOG_MAX_MODULE_LEVELS];
+static size_t g_log_num_module_levels;
+
+// The most verbose level enabled anywhere, allows for a single compare
+static enum log_level g_log_level_ceiling = LOG_LEVEL_INFO;
+
+static void log_update_ceiling(void)
+{
+    enum log_level ceiling = g_loglevel;
+    size_t i;
+
+    for (i = 0; i < g_log_num_module_levels; i++) {
+        if (g_log_module_levels[i].level > ceiling)
+            ceiling = g_log_module_levels[i].level;
+    }
+
+    atomic_store_relaxed(&g_log_level_ceiling, ceiling);
+}
+
+error_t log_set_level(enum log_level level)
+{
+    if (unlikely(level >= LOG_LEVEL_COUNT))
+        return EINVAL;
+
+    g_loglevel = level;
+    log_update_ceiling();
+    return EOK;
+}
+
+error_t log_set_module_level(struct string module, enum log_level level)
+{
+    struct log_module_level *ml;
+    size_t i;
+
+    if (unlikely(level >= LOG_LEVEL_COUNT || str_empty(module)))
+        return EINVAL;
+
+    for (i = 0; i < g_log_num_module_levels; i++) {
+        ml = &g_log_module_levels[i];
+
+        if (str_equals(ml->name, module))
+            goto out_set;
+    }
+
+    if (g_log_num_module_levels == LOG_MAX_MODULE_LEVELS)
+        return ENOSPC;
+
+    ml = &g_log_module_levels[g_log_num_module_levels];
+    ml->name = module;
+
+    /*
+     * Publish the entry only after it's fully initialized, the filter reads
+     * it without any locking.
+     */
+    ml->level = level;
+    atomic_store_release(&g_log_num_module_levels, i + 1);
+
+out_set:
+    atomic_store_relaxed(&ml->level, level);
+    log_update_ceiling();
+    return EOK;
+}
+
+// Checks whether 'msg' starts with "<module>: " as produced by MSG_FMT
+static bool msg_is_from_module(const char *msg, struct string module)
+{
+    size_t i;
+
+    for (i = 0; i < module.size; i++) {
+        if (msg[i] != module.text[i])
+            return false;
+    }
+
+    return msg[i] == ':' && msg[i + 1] == ' ';
+}
+
+static bool log_level_enabled(enum log_level level, const char *msg)
+{
+    size_t i, count;
+
+    if (likely(level <= g_loglevel)) {
+        // Nothing might be configured to be less verbose than the default
+        if (likely(atomic_load_relaxed(&g_log_num_module_levels) == 0))
+            return true;
+    } else if (likely(level > atomic_load_relaxed(&g_log_level_ceiling))) {
+        return false;
+    }
+
+    count = atomic_load_acquire(&g_log_num_module_levels);
+
+    for (i = 0; i < count; i++) {
+        struct log_module_level *ml = &g_log_module_levels[i];
+
+        if (msg_is_from_module(msg, ml->name))
+            return level <= atomic_load_relaxed(&ml->level);
+    }
+
+    return level <= g_loglevel;
+}
+
+/*
+ * Set once the idle loop is up to run softirqs. Before that nothing would
+ * drain the log for the whole boot, so task context writes records out right
+ * away instead.
+ */
+static bool g_log_deferred;
+
+void log_enable_deferred_output(void)
+{
+    atomic_store_release(&g_log_deferred, true);
+}
+
+static void do_vprint(enum log_level level, const char *msg, va_list vlist)
+{
+    if (!log_level_enabled(level, msg))
+        return;
+
+    log_vstore(level, msg, vlist);
+
+    if (!atomic_load_acquire(&g_log_deferred) && !in_interrupt()) {
+        console_flush();
+        return;
+    }
+
+    /*
+     * Producers only ever pay for formatting the record, the consoles are
+     * driven from a softirq. Anyone who needs the output right away has to
+     * call console_flush() explicitly.
+     */
+    softirq_raise(SOFTIRQ_LOG);
+}
+
 void vprint(const char *msg, va_list vlist)
 {
-    static char log_buf[256];
     enum log_level level = LOG_LEVEL_DEFAULT;
-    int chars;
 
     if (unlikely(!msg))
         return;
 
     msg += extract_msg_level(msg, &level);
-
-    chars = vscnprintf(log_buf, sizeof(log_buf), msg, vlist);
-    if (unlikely(chars < 0))
-        return;
-
-    console_write(log_buf, chars);
+    do_vprint(level, msg, vlist);
 }
 
 void print(const char *msg, ...)
@@ -49,6 +377,75 @@ void print(const char *msg, ...)
     va_end(vlist);
 }
 
+PRINTF_DECL(2, 3)
+static void print_with_level(enum log_level level, const char *msg, ...)
+{
+    va_list vlist;
+    va_start(vlist, msg);
+    do_vprint(level, msg, vlist);
+    va_end(vlist);
+}
+
+static error_t loglevel_set(struct string str, struct param *p)
+{
+    u8 level;
+    error_t ret;
+
+    UNREFERENCED_PARAMETER(p);
+
+    ret = str_to_u8(str, &level);
+    if (is_error(ret))
+        return ret;
+
+    return log_set_level(level);
+}
+
+static const struct param_ops g_loglevel_ops = {
+    .set = loglevel_set,
+    .get = param_get_u8,
+};
+early_parameter_with_ops(g_loglevel, g_loglevel_ops);
+
+/*
+ * Per-module overrides in the form of log_modules=<module>:<level>,...
+ * where <module> is the MSG_FMT prefix without the trailing ": ".
+ */
+static struct string g_log_modules;
+
+static error_t log_modules_set(struct string str, struct param *p)
+{
+    struct string entry, rest = str;
+    ssize_t sep;
+    u8 level;
+    error_t ret;
+
+    while (!str_empty(rest)) {
+        sep = str_find_one(rest, ',', 0);
+        entry = str_substring(rest, 0, sep < 0 ? rest.size : (size_t)sep);
+        str_offset_by(&rest, sep < 0 ? rest.size : (size_t)sep + 1);
+
+        sep = str_find_one(entry, ':', 0);
+        if (sep < 0)
+            return EINVAL;
+
+        ret = str_to_u8(str_substring(entry, sep + 1, entry.size), &level);
+        if (is_error(ret))
+            return ret;
+
+        ret = log_set_module_level(str_substring(entry, 0, sep), level);
+        if (is_error(ret))
+            return ret;
+    }
+
+    return param_set_string(str, p);
+}
+
+static const struct param_ops g_log_modules_ops = {
+    .set = log_modules_set,
+    .get = param_get_string,
+};
+early_parameter_with_ops(g_log_modules, g_log_modules_ops);
+
 struct dump_state {
     enum log_level level;
     size_t depth;
@@ -57,34 +454,27 @@ struct dump_state {
 static bool do_dump_frame(void *user, ptr_t addr, bool addr_after_call)
 {
     struct dump_state *state = user;
-    char sym[MAX_SYMBOL_LENGTH];
-    ptr_t lookup_addr;
-    size_t offset;
-
-    lookup_addr = addr_after_call ? addr - 1 : addr;
 
-    if (is_error(symbol_lookup_by_address(lookup_addr, sym, &offset))) {
-        print(
-        "    #%zu in unknown/garbage <0x%016zX>\n", state->depth, addr
+    if (addr_after_call) {
+        print_with_level(
+            state->level, "    #%zu in %pB\n", state->depth++, (void*)addr
+        );
+    } else {
+        print_with_level(
+            state->level, "    #%zu in %pF\n", state->depth++, (void*)addr
         );
-        goto out;
     }
 
-    print("    #%zu in %s+%zu\n", state->depth, sym, offset);
-
-out:
-    state->depth++;
     return true;
 }
 
 void dump_stack(enum log_level level, struct registers *regs)
 {
     struct dump_state state = {
-        // FIXME: support extracting the log level via %s
         .level = level,
         .depth = 0,
     };
 
-    print("Call trace (most recent call first):\n");
+    print_with_level(level, "Call trace (most recent call first):\n");
     unwind_walk(regs, do_dump_frame, &state);
 }
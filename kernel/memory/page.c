@@ -0,0 +1,16 @@
+#include <common/align.h>
+#include <common/string.h>
+#include <common/types.h>
+
+#include <memory/page.h>
+
+// Architectures with cache-bypassing stores override these
+WEAK void clear_page(void *page)
+{
+    memzero(page, PAGE_SIZE);
+}
+
+WEAK void copy_page(void *dest, const void *src)
+{
+    memcpy(dest, src, PAGE_SIZE);
+}
@@ -3,6 +3,7 @@
 #include <common/atomic.h>
 #include <common/format.h>
 
+#include <console.h>
 #include <panic.h>
 #include <log.h>
 
@@ -23,6 +24,9 @@ void panic(const char *reason, ...)
     pr_emerg("Kernel panic: %s", panic_buf);
     dump_stack(LOG_LEVEL_EMERG, NULL);
 
+    // We might have interrupted whoever was printing the log
+    console_force_flush();
+
 hang:
     for (;;);
 }
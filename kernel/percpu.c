@@ -0,0 +1,58 @@
+#define MSG_FMT(msg) "percpu: " msg
+
+#include <common/align.h>
+#include <common/string.h>
+#include <common/types.h>
+
+#include <boot/alloc.h>
+#include <bug.h>
+#include <io.h>
+#include <linker.h>
+#include <log.h>
+#include <percpu.h>
+#include <smp.h>
+
+extern u8 SECTION_ARRAY_BEGIN(PERCPU_SECTION)[];
+extern u8 SECTION_ARRAY_END(PERCPU_SECTION)[];
+extern u8 LINKER_SYMBOL(percpu_bsp_area)[];
+
+ptr_t g_percpu_offsets[MAX_CPUS];
+
+DEFINE_PER_CPU(u32, g_this_cpu_id);
+DEFINE_PER_CPU(ptr_t, g_this_cpu_offset);
+
+static void percpu_setup(u32 cpu, u8 *area)
+{
+    ptr_t offset;
+
+    memcpy(area, SECTION_ARRAY_BEGIN(PERCPU_SECTION),
+           SECTION_ARRAY_SIZE(PERCPU_SECTION));
+
+    offset = (ptr_t)area - (ptr_t)SECTION_ARRAY_BEGIN(PERCPU_SECTION);
+    g_percpu_offsets[cpu] = offset;
+
+    per_cpu(g_this_cpu_id, cpu) = cpu;
+    per_cpu(g_this_cpu_offset, cpu) = offset;
+}
+
+void percpu_init(void)
+{
+    percpu_setup(0, LINKER_SYMBOL(percpu_bsp_area));
+    arch_percpu_activate(g_percpu_offsets[0]);
+}
+
+error_t percpu_alloc_cpu(u32 cpu)
+{
+    size_t size = SECTION_ARRAY_SIZE(PERCPU_SECTION);
+    phys_addr_t phys;
+
+    BUG_ON(cpu == 0 || cpu >= MAX_CPUS);
+
+    phys = boot_alloc(PAGE_ROUND_UP(size) >> PAGE_SHIFT);
+    if (error_phys_addr(phys))
+        return decode_error_phys_addr(phys);
+
+    percpu_setup(cpu, phys_to_virt(phys));
+    pr_info("CPU%u area at 0x%016llX (%zu bytes)\n", cpu, (u64)phys, size);
+    return EOK;
+}
@@ -0,0 +1,215 @@
+#define MSG_FMT(msg) "smp-call: " msg
+
+#include <common/atomic.h>
+#include <common/attributes.h>
+#include <common/helpers.h>
+#include <common/types.h>
+
+#include <bug.h>
+#include <irq.h>
+#include <log.h>
+#include <percpu.h>
+#include <smp.h>
+#include <smp_call.h>
+
+#include <private/arch/ipi.h>
+
+static DEFINE_PER_CPU(struct smp_call*, g_call_queue);
+static DEFINE_PER_CPU(struct smp_call_stats, g_call_stats);
+static int g_call_vector = -1;
+
+static struct smp_call_stats *this_call_stats(void)
+{
+    return this_cpu_ptr(&g_call_stats);
+}
+
+static void smp_call_run(struct smp_call *call)
+{
+    call->func(call->arg);
+    this_call_stats()->calls_executed++;
+
+    // The caller is free to reuse the storage after this point
+    atomic_store_release(&call->done, true);
+}
+
+static enum irq_return smp_call_ipi(struct registers *regs, void *user)
+{
+    struct smp_call *call, *next, *fifo = NULL;
+    UNREFERENCED_PARAMETER(regs);
+    UNREFERENCED_PARAMETER(user);
+
+    this_call_stats()->ipis_received++;
+
+    /*
+     * Acknowledge before draining, a call pushed onto the now empty queue
+     * sends a new IPI that must not be blocked by this one.
+     */
+    arch_ack_ipi();
+
+    /*
+     * Detach everything queued so far, anything pushed after this point finds
+     * an empty queue and sends a new IPI.
+     */
+    call = atomic_xchg(this_cpu_ptr(&g_call_queue), NULL, MO_ACQUIRE);
+
+    // The queue is LIFO, restore submission order
+    for (; call; call = next) {
+        next = call->next;
+        call->next = fifo;
+        fifo = call;
+    }
+
+    for (call = fifo; call; call = next) {
+        next = call->next;
+        smp_call_run(call);
+    }
+
+    return IRQ_HANDLED;
+}
+
+static struct irq_action g_call_action = {
+    .name = "smp-call",
+    .handler = smp_call_ipi,
+    .flags = IRQ_FAST,
+};
+
+error_t smp_call_async(u32 cpu, struct smp_call *call)
+{
+    struct smp_call_stats *stats;
+    struct smp_call *head, **queue;
+    ptr_t flags;
+
+    if (unlikely(cpu >= smp_num_cpus() || call->func == NULL))
+        return EINVAL;
+
+    call->done = false;
+
+    // Keep the stats and the queue on the same CPU
+    flags = local_irq_save();
+
+    if (unlikely(cpu != smp_processor_id() && g_call_vector < 0)) {
+        local_irq_restore(flags);
+        return ENODEV;
+    }
+
+    stats = this_call_stats();
+    stats->calls_queued++;
+
+    if (cpu == smp_processor_id()) {
+        smp_call_run(call);
+        goto out;
+    }
+
+    queue = per_cpu_ptr(&g_call_queue, cpu);
+    head = atomic_load_relaxed(queue);
+    do {
+        call->next = head;
+    } while (!atomic_cmpxchg_explicit(queue, head, call,
+                                      MO_RELEASE, MO_RELAXED));
+
+    /*
+     * A non-empty queue means the target hasn't drained it yet, and it's
+     * guaranteed to see our call when it does.
+     */
+    if (head != NULL) {
+        stats->ipis_coalesced++;
+        goto out;
+    }
+
+    arch_send_ipi(cpu, g_call_vector);
+    stats->ipis_sent++;
+
+out:
+    local_irq_restore(flags);
+    return EOK;
+}
+
+void smp_call_wait(struct smp_call *call)
+{
+    while (!smp_call_is_done(call))
+        cpu_relax();
+}
+
+error_t smp_call_sync(u32 cpu, smp_call_func_t func, void *arg)
+{
+    struct smp_call call = {
+        .func = func,
+        .arg = arg,
+    };
+    error_t ret;
+
+    ret = smp_call_async(cpu, &call);
+    if (is_error(ret))
+        return ret;
+
+    smp_call_wait(&call);
+    return EOK;
+}
+
+void smp_call_get_stats(u32 cpu, struct smp_call_stats *out_stats)
+{
+    BUG_ON(cpu >= smp_num_cpus());
+    *out_stats = per_cpu(g_call_stats, cpu);
+}
+
+void smp_call_dump_stats(void)
+{
+    struct smp_call_stats stats;
+    u32 cpu;
+
+    for (cpu = 0; cpu < smp_num_cpus(); cpu++) {
+        smp_call_get_stats(cpu, &stats);
+
+        pr_info(
+            "CPU%u: %llu queued, %llu ipis sent, %llu coalesced, "
+            "%llu executed, %llu ipis received\n", cpu, stats.calls_queued,
+            stats.ipis_sent, stats.ipis_coalesced, stats.calls_executed,
+            stats.ipis_received
+        );
+    }
+}
+
+error_t smp_call_init(void)
+{
+    int vector;
+    error_t ret;
+
+    ret = arch_ipi_init();
+    if (is_error(ret))
+        return ret;
+
+    vector = irq_alloc_vector();
+    if (is_nerror(vector))
+        return -vector;
+
+    ret = irq_register(vector, &g_call_action);
+    if (is_error(ret)) {
+        irq_free_vector(vector);
+        return ret;
+    }
+
+    g_call_vector = vector;
+    return EOK;
+}
+
+/*
+ * NOTE:
+ * Below are generic implementations for architectures that can't send IPIs
+ * (yet), cross-CPU calls are simply unavailable there.
+ */
+
+WEAK error_t arch_ipi_init(void)
+{
+    return ENODEV;
+}
+
+WEAK void arch_send_ipi(u32 cpu, u32 vector)
+{
+    UNREFERENCED_PARAMETER(cpu);
+    UNREFERENCED_PARAMETER(vector);
+    BUG();
+}
+
+WEAK void arch_ack_ipi(void)
+{
+}
@@ -0,0 +1,236 @@
+#define MSG_FMT(msg) "softirq: " msg
+
+#include <common/atomic.h>
+#include <common/helpers.h>
+#include <common/types.h>
+
+#include <bug.h>
+#include <console.h>
+#include <irq.h>
+#include <log.h>
+#include <percpu.h>
+#include <smp.h>
+#include <softirq.h>
+
+#include <arch/cycles.h>
+
+/*
+ * How many times irq_exit() re-runs handlers raised while it was already
+ * processing softirqs. Anything raised past that is left to the idle loop so
+ * that an interrupt storm can't starve the interrupted context forever.
+ */
+#define SOFTIRQ_MAX_RESTARTS 10
+
+struct softirq_cpu {
+    u32 pending;
+    u32 hardirq_depth;
+    u32 softirq_depth;
+
+    u64 hardirq_enter_ts;
+    struct softirq_stats stats;
+
+    struct tasklet *tasklet_head;
+    struct tasklet **tasklet_tail;
+};
+
+static DEFINE_PER_CPU(struct softirq_cpu, g_softirq_cpu);
+
+static void tasklet_action(void);
+
+static softirq_handler_t g_softirq_handlers[SOFTIRQ_COUNT] = {
+    [SOFTIRQ_TASKLET] = tasklet_action,
+    [SOFTIRQ_LOG] = console_flush_deferred,
+};
+
+static struct softirq_cpu *this_softirq_cpu(void)
+{
+    return this_cpu_ptr(&g_softirq_cpu);
+}
+
+void softirq_register(enum softirq_type type, softirq_handler_t handler)
+{
+    BUG_ON(type >= SOFTIRQ_COUNT);
+    BUG_ON(g_softirq_handlers[type] != NULL);
+
+    atomic_store_release(&g_softirq_handlers[type], handler);
+}
+
+void softirq_raise(enum softirq_type type)
+{
+    ptr_t flags;
+
+    BUG_ON(type >= SOFTIRQ_COUNT);
+
+    // do_softirq() would jump to address 0 otherwise
+    if (WARN_ON(atomic_load_acquire(&g_softirq_handlers[type]) == NULL))
+        return;
+
+    flags = local_irq_save();
+    this_softirq_cpu()->pending |= 1u << type;
+    local_irq_restore(flags);
+}
+
+bool in_hardirq(void)
+{
+    return this_softirq_cpu()->hardirq_depth != 0;
+}
+
+bool in_softirq(void)
+{
+    return this_softirq_cpu()->softirq_depth != 0;
+}
+
+// Must be called with interrupts disabled
+static void do_softirq(struct softirq_cpu *sc)
+{
+    size_t restarts = SOFTIRQ_MAX_RESTARTS;
+    u64 start, hardirq_before;
+    u32 pending;
+
+    sc->softirq_depth++;
+    start = arch_read_cycles();
+    hardirq_before = sc->stats.hardirq_cycles;
+
+    do {
+        pending = sc->pending;
+        sc->pending = 0;
+
+        local_irq_enable();
+
+        while (pending) {
+            u32 type = __builtin_ctz(pending);
+
+            pending &= pending - 1;
+            g_softirq_handlers[type]();
+            sc->stats.runs[type]++;
+        }
+
+        local_irq_disable();
+    } while (sc->pending && --restarts);
+
+    // Don't account hard interrupts that nested inside softirq processing
+    sc->stats.softirq_cycles += (arch_read_cycles() - start) -
+                                (sc->stats.hardirq_cycles - hardirq_before);
+    sc->softirq_depth--;
+}
+
+void irq_enter(void)
+{
+    struct softirq_cpu *sc = this_softirq_cpu();
+
+    if (sc->hardirq_depth++ == 0)
+        sc->hardirq_enter_ts = arch_read_cycles();
+
+    sc->stats.hardirq_count++;
+}
+
+void irq_exit(void)
+{
+    struct softirq_cpu *sc = this_softirq_cpu();
+
+    BUG_ON(sc->hardirq_depth == 0);
+
+    if (--sc->hardirq_depth != 0)
+        return;
+
+    sc->stats.hardirq_cycles += arch_read_cycles() - sc->hardirq_enter_ts;
+
+    if (sc->pending && sc->softirq_depth == 0)
+        do_softirq(sc);
+}
+
+void softirq_run_pending(void)
+{
+    struct softirq_cpu *sc;
+    ptr_t flags;
+
+    flags = local_irq_save();
+    sc = this_softirq_cpu();
+
+    if (sc->pending && sc->hardirq_depth == 0 && sc->softirq_depth == 0)
+        do_softirq(sc);
+
+    local_irq_restore(flags);
+}
+
+bool softirq_pending(void)
+{
+    return this_softirq_cpu()->pending != 0;
+}
+
+void tasklet_schedule(struct tasklet *t)
+{
+    struct softirq_cpu *sc;
+    ptr_t flags;
+
+    flags = local_irq_save();
+
+    if (t->scheduled)
+        goto out;
+
+    sc = this_softirq_cpu();
+    if (sc->tasklet_tail == NULL)
+        sc->tasklet_tail = &sc->tasklet_head;
+
+    t->scheduled = true;
+    t->next = NULL;
+    *sc->tasklet_tail = t;
+    sc->tasklet_tail = &t->next;
+    sc->pending |= 1u << SOFTIRQ_TASKLET;
+
+out:
+    local_irq_restore(flags);
+}
+
+static void tasklet_action(void)
+{
+    struct softirq_cpu *sc = this_softirq_cpu();
+    struct tasklet *list, *t;
+
+    // Detach the whole list at once, tasklets scheduled from now on batch up
+    local_irq_disable();
+    list = sc->tasklet_head;
+    sc->tasklet_head = NULL;
+    sc->tasklet_tail = &sc->tasklet_head;
+    local_irq_enable();
+
+    while (list) {
+        t = list;
+        list = list->next;
+
+        /*
+         * Clear the flag before running so that the tasklet is able to
+         * reschedule itself.
+         */
+        t->scheduled = false;
+        t->func(t);
+    }
+}
+
+void softirq_get_stats(u32 cpu, struct softirq_stats *out_stats)
+{
+    ptr_t flags;
+
+    BUG_ON(cpu >= smp_num_cpus());
+
+    flags = local_irq_save();
+    *out_stats = per_cpu(g_softirq_cpu, cpu).stats;
+    local_irq_restore(flags);
+}
+
+void softirq_dump_stats(void)
+{
+    struct softirq_stats stats;
+    u32 cpu;
+
+    for (cpu = 0; cpu < smp_num_cpus(); cpu++) {
+        softirq_get_stats(cpu, &stats);
+
+        pr_info(
+            "CPU%u: %llu irqs, %llu cycles in hard irq, %llu cycles deferred "
+            "(%llu tasklet runs)\n", cpu, stats.hardirq_count,
+            stats.hardirq_cycles, stats.softirq_cycles,
+            stats.runs[SOFTIRQ_TASKLET]
+        );
+    }
+}
@@ -1,3 +1,5 @@
+#include <common/atomic.h>
+#include <common/minmax.h>
 #include <common/string.h>
 
 #include <leb128.h>
@@ -17,7 +19,7 @@ static u16 get_compressed_symbol_length(const u8 **cursor)
     return len;
 }
 
-static void uncompress_symbol(
+static size_t uncompress_symbol(
     const u8 *compressed_cursor, char out_buf[MAX_SYMBOL_LENGTH]
 )
 {
@@ -37,6 +39,7 @@ static void uncompress_symbol(
     }
 
     *out_cursor = '\0';
+    return out_cursor - out_buf;
 }
 
 static const u8 *get_compressed_symbol_name_cursor(u32 index)
@@ -44,8 +47,10 @@ static const u8 *get_compressed_symbol_name_cursor(u32 index)
     const u8 *cursor;
     u32 i;
 
-    cursor = &g_symbol_compressed_names[g_symbol_name_offsets[index >> 8]];
-    index &= 0xFF;
+    cursor = &g_symbol_compressed_names[
+        g_symbol_name_offsets[index >> g_symbol_name_offset_shift]
+    ];
+    index &= (1u << g_symbol_name_offset_shift) - 1;
 
     for (i = 0; i < index; i++)
         cursor += get_compressed_symbol_length(&cursor);
@@ -53,20 +58,124 @@ static const u8 *get_compressed_symbol_name_cursor(u32 index)
     return cursor;
 }
 
+/*
+ * Direct-mapped cache of recently resolved addresses, repeated traces such as
+ * a WARN on a hot path keep hitting the same handful of return addresses.
+ * Each entry is guarded by a sequence counter that is odd while the entry is
+ * being rewritten, readers that race with a writer simply take the slow path
+ * and writers never wait for each other.
+ */
+#define SYMBOL_CACHE_SHIFT 6
+#define SYMBOL_CACHE_SIZE (1 << SYMBOL_CACHE_SHIFT)
+
+struct symbol_cache_entry {
+    u32 seq;
+    u32 offset;
+    ptr_t address;
+    u8 name_length;
+    char name[MAX_SYMBOL_LENGTH];
+};
+
+static struct symbol_cache_entry g_symbol_cache[SYMBOL_CACHE_SIZE];
+
+static struct symbol_cache_entry *symbol_cache_entry(ptr_t address)
+{
+    u64 hash = (u64)address * 0x9E3779B97F4A7C15ull;
+
+    return &g_symbol_cache[hash >> (64 - SYMBOL_CACHE_SHIFT)];
+}
+
+static bool symbol_cache_lookup(
+    ptr_t address, char out_name_buf[MAX_SYMBOL_LENGTH],
+    size_t *out_offset_within
+)
+{
+    struct symbol_cache_entry *entry = symbol_cache_entry(address);
+    u32 seq, offset;
+    u8 name_length;
+
+    seq = atomic_load_acquire(&entry->seq);
+    if (seq & 1)
+        return false;
+
+    if (atomic_load_relaxed(&entry->address) != address)
+        return false;
+
+    name_length = atomic_load_relaxed(&entry->name_length);
+    if (unlikely(name_length >= MAX_SYMBOL_LENGTH))
+        return false;
+
+    offset = atomic_load_relaxed(&entry->offset);
+    memcpy(out_name_buf, entry->name, name_length);
+    out_name_buf[name_length] = '\0';
+
+    barrier_acquire();
+    if (atomic_load_relaxed(&entry->seq) != seq)
+        return false;
+
+    if (out_offset_within != NULL)
+        *out_offset_within = offset;
+
+    return true;
+}
+
+static void symbol_cache_insert(
+    ptr_t address, const char *name, size_t name_length, u32 offset
+)
+{
+    struct symbol_cache_entry *entry = symbol_cache_entry(address);
+    u32 seq;
+
+    seq = atomic_load_relaxed(&entry->seq);
+    if ((seq & 1) || !atomic_cmpxchg_acq_rel(&entry->seq, seq, seq + 1))
+        return;
+
+    atomic_store_relaxed(&entry->address, address);
+    atomic_store_relaxed(&entry->offset, offset);
+    atomic_store_relaxed(&entry->name_length, name_length);
+    memcpy(entry->name, name, name_length);
+
+    atomic_store_release(&entry->seq, seq + 2);
+}
+
+/*
+ * Narrows down the range of symbols that may contain 'rel_address' to
+ * [begin, end) using the address index.
+ */
+static void get_symbol_search_range(u32 rel_address, u32 *begin, u32 *end)
+{
+    u32 page = rel_address >> g_symbol_address_index_shift;
+    u32 last_page = g_symbol_address_index_size - 1;
+
+    if (page >= last_page) {
+        *begin = g_symbol_address_index[last_page];
+        *end = g_symbol_count;
+        return;
+    }
+
+    *begin = g_symbol_address_index[page];
+    *end = g_symbol_address_index[page + 1] + 1;
+}
+
 error_t symbol_lookup_by_address(
     ptr_t address, char out_name_buf[MAX_SYMBOL_LENGTH],
     size_t *out_offset_within
 )
 {
     u32 rel_address, symbol_base;
-    u32 i, begin = 0, end = g_symbol_count;
+    u32 i, begin, end;
+    size_t name_length;
 
     if (unlikely(!address_is_kernel_code(address)))
         return EINVAL;
     if (unlikely(g_symbol_count == 0))
         return ENOSYS;
 
+    if (symbol_cache_lookup(address, out_name_buf, out_offset_within))
+        return EOK;
+
     rel_address = address - g_symbol_base;
+    get_symbol_search_range(rel_address, &begin, &end);
 
     while (end - begin > 1) {
         i = begin + ((end - begin) / 2);
@@ -81,9 +190,165 @@ error_t symbol_lookup_by_address(
     if (out_offset_within != NULL)
         *out_offset_within = rel_address - symbol_base;
 
-    uncompress_symbol(
+    name_length = uncompress_symbol(
         get_compressed_symbol_name_cursor(begin),
         out_name_buf
     );
+
+    symbol_cache_insert(address, out_name_buf, name_length,
+                        rel_address - symbol_base);
+    return EOK;
+}
+
+static u32 get_address_index_by_name_index(u32 name_index)
+{
+    const u8 *entry = &g_symbol_name_index_to_address_index[name_index * 3];
+
+    return (entry[0] << 16) | (entry[1] << 8) | entry[2];
+}
+
+static size_t get_token_length(u8 token)
+{
+    if (unlikely(token == 0xFF))
+        return strlen(&g_symbol_token_table[g_symbol_token_offsets[token]]);
+
+    return g_symbol_token_offsets[token + 1] -
+           g_symbol_token_offsets[token] - 1;
+}
+
+enum symbol_match {
+    SYMBOL_MATCH_EXACT,
+    SYMBOL_MATCH_PREFIX,
+};
+
+/*
+ * Compares a compressed symbol name against 'query' one token at a time,
+ * stopping at the first token that differs. The result has the same meaning
+ * as for memcmp(), except that names starting with 'query' compare equal for
+ * SYMBOL_MATCH_PREFIX.
+ */
+static int compressed_symbol_compare(
+    const u8 *cursor, struct string query, enum symbol_match match
+)
+{
+    const char *token;
+    size_t token_length, remaining, pos = 0;
+    u16 len;
+    int ret;
+
+    len = get_compressed_symbol_length(&cursor);
+
+    while (len--) {
+        token = &g_symbol_token_table[g_symbol_token_offsets[*cursor]];
+        token_length = get_token_length(*cursor++);
+        remaining = query.size - pos;
+
+        ret = memcmp(token, &query.text[pos], MIN(token_length, remaining));
+        if (ret != 0)
+            return ret;
+
+        if (token_length > remaining)
+            return match == SYMBOL_MATCH_PREFIX ? 0 : 1;
+
+        pos += token_length;
+    }
+
+    return pos == query.size ? 0 : -1;
+}
+
+static int symbol_compare_by_name_index(
+    u32 name_index, struct string query, enum symbol_match match
+)
+{
+    u32 address_index = get_address_index_by_name_index(name_index);
+
+    return compressed_symbol_compare(
+        get_compressed_symbol_name_cursor(address_index), query, match
+    );
+}
+
+// Returns the first name index that doesn't compare less than 'query'
+static u32 symbol_lower_bound(struct string query, enum symbol_match match)
+{
+    u32 i, begin = 0, end = g_symbol_count;
+
+    while (begin < end) {
+        i = begin + ((end - begin) / 2);
+
+        if (symbol_compare_by_name_index(i, query, match) < 0)
+            begin = i + 1;
+        else
+            end = i;
+    }
+
+    return begin;
+}
+
+static ptr_t get_symbol_address(u32 address_index)
+{
+    return g_symbol_base + g_symbol_relative_addresses[address_index];
+}
+
+error_t symbol_lookup_by_name(struct string name, ptr_t *out_address)
+{
+    u32 name_index;
+
+    if (unlikely(g_symbol_count == 0))
+        return ENOSYS;
+
+    name_index = symbol_lower_bound(name, SYMBOL_MATCH_EXACT);
+    if (name_index == g_symbol_count ||
+        symbol_compare_by_name_index(name_index, name, SYMBOL_MATCH_EXACT))
+        return ENOENT;
+
+    *out_address = get_symbol_address(
+        get_address_index_by_name_index(name_index)
+    );
+    return EOK;
+}
+
+error_t symbol_for_each_with_prefix(
+    struct string prefix, symbol_cb_t callback, void *user
+)
+{
+    char name[MAX_SYMBOL_LENGTH];
+    u32 name_index, address_index;
+    const u8 *cursor;
+
+    if (unlikely(g_symbol_count == 0))
+        return ENOSYS;
+
+    name_index = symbol_lower_bound(prefix, SYMBOL_MATCH_PREFIX);
+
+    for (; name_index < g_symbol_count; name_index++) {
+        address_index = get_address_index_by_name_index(name_index);
+        cursor = get_compressed_symbol_name_cursor(address_index);
+
+        if (compressed_symbol_compare(cursor, prefix, SYMBOL_MATCH_PREFIX))
+            break;
+
+        uncompress_symbol(cursor, name);
+        if (!callback(user, name, get_symbol_address(address_index)))
+            break;
+    }
+
+    return EOK;
+}
+
+error_t symbol_resolve_imports(
+    struct symbol_import *imports, size_t count, size_t *out_failed_idx
+)
+{
+    size_t i;
+    error_t ret;
+
+    for (i = 0; i < count; i++) {
+        ret = symbol_lookup_by_name(imports[i].name, &imports[i].address);
+        if (unlikely(is_error(ret))) {
+            *out_failed_idx = i;
+            return ret;
+        }
+    }
+
     return EOK;
 }
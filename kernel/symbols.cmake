@@ -7,7 +7,10 @@ function(ultra_symbol_file)
         ${ARGN}
     )
     if (ARG_BINARY)
-        set(BINARY_FLAGS "--binary;${ARG_BINARY}")
+        set(
+            BINARY_FLAGS
+            "--binary;${ARG_BINARY};--cache;${ULTRA_SYMBOL_TOKEN_CACHE}"
+        )
     endif ()
 
     if (ARG_DEPENDENCY)
@@ -22,16 +25,69 @@ function(ultra_symbol_file)
         ${DEPENDENCY_FLAGS}
         COMMAND_EXPAND_LISTS
     )
+
+    # Keep the table contents opaque to LTO, otherwise e.g. g_symbol_count
+    # gets folded into the code and every new table shifts the code around,
+    # requiring more relinks to converge.
+    set_source_files_properties(
+        ${ARG_OUTPUT_PATH}
+        PROPERTIES
+        COMPILE_OPTIONS -fno-lto
+    )
+endfunction()
+
+function(ultra_unwind_table_file)
+    cmake_parse_arguments(
+        ARG
+        ""
+        "OUTPUT_PATH;BINARY;DEPENDENCY"
+        ""
+        ${ARGN}
+    )
+    if (ARG_BINARY)
+        set(BINARY_FLAGS "--binary;${ARG_BINARY}")
+    endif ()
+
+    if (ARG_DEPENDENCY)
+        set(DEPENDENCY_FLAGS "DEPENDS;${ARG_BINARY}")
+    endif ()
+
+    add_custom_command(
+        OUTPUT ${ARG_OUTPUT_PATH}
+        COMMAND
+        python3 ${ULTRA_SCRIPTS_DIR}/generate_unwind_tables.py
+        ${ARG_OUTPUT_PATH} ${BINARY_FLAGS}
+        ${DEPENDENCY_FLAGS}
+        COMMAND_EXPAND_LISTS
+    )
+
+    # Same as the symbol tables, the contents must not affect code generation
+    set_source_files_properties(
+        ${ARG_OUTPUT_PATH}
+        PROPERTIES
+        COMPILE_OPTIONS -fno-lto
+    )
 endfunction()
 
 function(setup_symbol_table_link_steps NUM_RELINKS)
     set(SYMBOLS_STUB "kernel_symbols_stub.c")
 
+    # Interned token table shared by every stage, as well as across
+    # incremental builds that don't add, remove or rename symbols
+    set(
+        ULTRA_SYMBOL_TOKEN_CACHE
+        "${CMAKE_CURRENT_BINARY_DIR}/kernel_symbols_tokens.json"
+    )
+
+    set(UNWIND_TABLE_STUB "kernel_unwind_table_stub.c")
+
     ultra_symbol_file(OUTPUT_PATH ${SYMBOLS_STUB})
+    ultra_unwind_table_file(OUTPUT_PATH ${UNWIND_TABLE_STUB})
     target_sources(
         ${ULTRA_KERNEL_BASE}
         PRIVATE
         ${SYMBOLS_STUB}
+        ${UNWIND_TABLE_STUB}
     )
 
     math(EXPR NUM_STEPS "${NUM_RELINKS} - 1")
@@ -41,9 +97,11 @@ function(setup_symbol_table_link_steps NUM_RELINKS)
         if (I EQUAL ${NUM_STEPS})
             set(THIS_TARGET "kernel-${ULTRA_ARCH_EXECUTION_MODE}")
             set(THIS_SYMBOL_FILE "kernel_symbols_final.c")
+            set(THIS_UNWIND_TABLE_FILE "kernel_unwind_table_final.c")
         else ()
             set(THIS_TARGET "kernel-${ULTRA_ARCH_EXECUTION_MODE}-prelim${I}")
             set(THIS_SYMBOL_FILE "kernel_symbols_prelim${I}.c")
+            set(THIS_UNWIND_TABLE_FILE "kernel_unwind_table_prelim${I}.c")
         endif ()
 
         list(GET ULTRA_KERNEL_TARGETS -1 PREV_TARGET)
@@ -57,8 +115,21 @@ function(setup_symbol_table_link_steps NUM_RELINKS)
             ${PREV_TARGET}
         )
 
+        ultra_unwind_table_file(
+            OUTPUT_PATH
+            ${THIS_UNWIND_TABLE_FILE}
+            BINARY
+            "$<TARGET_FILE:${PREV_TARGET}>"
+            DEPENDENCY
+            ${PREV_TARGET}
+        )
+
         list(APPEND ULTRA_KERNEL_TARGETS ${THIS_TARGET})
-        add_executable(${THIS_TARGET} ${THIS_SYMBOL_FILE})
+        add_executable(
+            ${THIS_TARGET}
+            ${THIS_SYMBOL_FILE}
+            ${THIS_UNWIND_TABLE_FILE}
+        )
     endforeach ()
 
     set(FINAL_SYMBOL_FILE "kernel_symbols_stability_check.c")
@@ -71,16 +142,30 @@ function(setup_symbol_table_link_steps NUM_RELINKS)
         ${THIS_TARGET}
     )
 
+    set(FINAL_UNWIND_TABLE_FILE "kernel_unwind_table_stability_check.c")
+    ultra_unwind_table_file(
+        OUTPUT_PATH
+        ${FINAL_UNWIND_TABLE_FILE}
+        BINARY
+        "$<TARGET_FILE:${THIS_TARGET}>"
+        DEPENDENCY
+        ${THIS_TARGET}
+    )
+
     add_custom_target(
         ensure-symbol-table-stabilized
         ALL
         COMMAND
         ${CMAKE_COMMAND} -E compare_files
         ${THIS_SYMBOL_FILE} ${FINAL_SYMBOL_FILE}
+        COMMAND
+        ${CMAKE_COMMAND} -E compare_files
+        ${THIS_UNWIND_TABLE_FILE} ${FINAL_UNWIND_TABLE_FILE}
         DEPENDS
         ${THIS_SYMBOL_FILE} ${FINAL_SYMBOL_FILE}
+        ${THIS_UNWIND_TABLE_FILE} ${FINAL_UNWIND_TABLE_FILE}
         COMMENT
-        "Ensuring the symbol table has stabilized"
+        "Ensuring the symbol and unwind tables have stabilized"
     )
 
     set(ULTRA_KERNEL_TARGETS "${ULTRA_KERNEL_TARGETS}" PARENT_SCOPE)
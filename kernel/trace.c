@@ -0,0 +1,91 @@
+#define MSG_FMT(msg) "trace: " msg
+
+#include <common/atomic.h>
+#include <common/format.h>
+#include <common/types.h>
+
+#include <irq.h>
+#include <log.h>
+#include <percpu.h>
+#include <smp.h>
+#include <trace.h>
+
+#include <arch/cycles.h>
+
+// Number of events kept per CPU, older ones are overwritten
+#define TRACE_ENTRIES 256
+
+struct trace_entry {
+    u64 timestamp;
+    const char *fmt;
+    u64 num_args;
+    u64 args[TRACE_MAX_ARGS];
+};
+
+struct trace_buffer {
+    // Total number of events ever recorded on this CPU
+    u64 head;
+    struct trace_entry entries[TRACE_ENTRIES];
+};
+
+static DEFINE_PER_CPU(struct trace_buffer, g_trace_buffer);
+
+void trace_record(const char *fmt, const u64 *args, size_t num_args)
+{
+    struct trace_buffer *tb;
+    struct trace_entry *te;
+    ptr_t flags;
+    size_t i;
+
+    flags = local_irq_save();
+
+    tb = this_cpu_ptr(&g_trace_buffer);
+    te = &tb->entries[tb->head % TRACE_ENTRIES];
+
+    te->timestamp = arch_read_cycles();
+    te->fmt = fmt;
+    te->num_args = num_args;
+    for (i = 0; i < num_args; i++)
+        te->args[i] = args[i];
+
+    atomic_store_release(&tb->head, tb->head + 1);
+    local_irq_restore(flags);
+}
+
+static void trace_dump_cpu(u32 cpu)
+{
+    static char buf[LOG_LINE_MAX];
+    struct trace_buffer *tb = per_cpu_ptr(&g_trace_buffer, cpu);
+    struct trace_entry te;
+    u64 i, head;
+    int chars;
+
+    head = atomic_load_acquire(&tb->head);
+    i = head > TRACE_ENTRIES ? head - TRACE_ENTRIES : 0;
+
+    for (; i < head; i++) {
+        te = tb->entries[i % TRACE_ENTRIES];
+
+        // Overwritten while we were copying it
+        if (atomic_load_acquire(&tb->head) - i > TRACE_ENTRIES)
+            continue;
+
+        chars = vsnprintf_array(buf, sizeof(buf), te.fmt, te.args,
+                                te.num_args);
+        if (chars < 0) {
+            pr_warn("CPU%u [%llu]: bad format \"%s\"\n",
+                    cpu, te.timestamp, te.fmt);
+            continue;
+        }
+
+        pr_info("CPU%u [%llu]: %s", cpu, te.timestamp, buf);
+    }
+}
+
+void trace_dump(void)
+{
+    u32 cpu;
+
+    for (cpu = 0; cpu < smp_num_cpus(); cpu++)
+        trace_dump_cpu(cpu);
+}
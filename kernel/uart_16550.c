@@ -0,0 +1,194 @@
+#define MSG_FMT(msg) "uart: " msg
+
+#include <common/helpers.h>
+#include <common/minmax.h>
+#include <common/types.h>
+
+#include <io.h>
+#include <log.h>
+#include <smp.h>
+#include <uart_16550.h>
+
+#define UART_REG_THR 0 // Transmit holding register (write)
+#define UART_REG_RBR 0 // Receive buffer register (read)
+#define UART_REG_DLL 0 // Divisor latch low (DLAB=1)
+#define UART_REG_IER 1 // Interrupt enable register
+#define UART_REG_DLM 1 // Divisor latch high (DLAB=1)
+#define UART_REG_IIR 2 // Interrupt identification register (read)
+#define UART_REG_FCR 2 // FIFO control register (write)
+#define UART_REG_LCR 3 // Line control register
+#define UART_REG_MCR 4 // Modem control register
+#define UART_REG_LSR 5 // Line status register
+#define UART_REG_SCR 7 // Scratch register
+#define UART_NUM_REGS 8
+
+#define UART_IIR_FIFO_MASK (3 << 6)
+#define UART_IIR_FIFO_64 (1 << 5)
+
+#define UART_FCR_ENABLE (1 << 0)
+#define UART_FCR_CLEAR_RX (1 << 1)
+#define UART_FCR_CLEAR_TX (1 << 2)
+#define UART_FCR_64_BYTE (1 << 5)
+#define UART_FCR_TRIGGER_14 (3 << 6)
+
+#define UART_LCR_8N1 0x03
+#define UART_LCR_DLAB (1 << 7)
+
+#define UART_MCR_DTR (1 << 0)
+#define UART_MCR_RTS (1 << 1)
+#define UART_MCR_OUT2 (1 << 3)
+#define UART_MCR_LOOPBACK (1 << 4)
+
+#define UART_LSR_DR (1 << 0)
+#define UART_LSR_THRE (1 << 5)
+
+#define UART_PROBE_SPINS 1000
+
+#define UART_BASE_CLOCK 115200
+
+static u8 uart_read(struct uart_16550 *uart, size_t reg)
+{
+    return ioread8_at(uart->iow, reg);
+}
+
+static void uart_write(struct uart_16550 *uart, size_t reg, u8 value)
+{
+    iowrite8_at(uart->iow, reg, value);
+}
+
+static bool uart_thr_empty(struct uart_16550 *uart)
+{
+    return uart_read(uart, UART_REG_LSR) & UART_LSR_THRE;
+}
+
+/*
+ * Copies up to 'cap' bytes of 'str' into 'out' translating LF into CRLF.
+ * Returns the number of bytes written to 'out', '*consumed' is set to the
+ * number of input bytes used up.
+ */
+static size_t uart_translate(
+    const char *str, size_t count, char *out, size_t cap, size_t *consumed
+)
+{
+    size_t i, written = 0;
+
+    for (i = 0; i < count; i++) {
+        if (str[i] == '\n') {
+            if (cap - written < 2)
+                break;
+
+            out[written++] = '\r';
+        } else if (written == cap) {
+            break;
+        }
+
+        out[written++] = str[i];
+    }
+
+    *consumed = i;
+    return written;
+}
+
+// Writes out one FIFO worth of data straight from a linear buffer
+static void uart_fill_fifo(struct uart_16550 *uart, const char *buf, size_t n)
+{
+    iowrite8_many(uart->iow, UART_REG_THR, (const u8*)buf, n);
+}
+
+static void uart_poll_write(struct uart_16550 *uart, const char *str,
+                            size_t count)
+{
+    char chunk[64];
+    size_t consumed, n, i, step;
+
+    while (count) {
+        n = uart_translate(str, count, chunk, sizeof(chunk), &consumed);
+        str += consumed;
+        count -= consumed;
+
+        for (i = 0; i < n; i += step) {
+            step = MIN(n - i, uart->fifo_size);
+
+            while (!uart_thr_empty(uart))
+                cpu_relax();
+
+            uart_fill_fifo(uart, chunk + i, step);
+        }
+    }
+}
+
+static void uart_console_write(struct console *con, const char *str,
+                               size_t count)
+{
+    struct uart_16550 *uart = container_of(con, struct uart_16550, con);
+
+    uart_poll_write(uart, str, count);
+}
+
+static bool uart_probe(struct uart_16550 *uart)
+{
+    size_t i;
+
+    uart_write(uart, UART_REG_SCR, 0x5A);
+    if (uart_read(uart, UART_REG_SCR) != 0x5A)
+        return false;
+
+    // Loopback mode, anything transmitted is received back shortly after
+    uart_write(uart, UART_REG_MCR, UART_MCR_LOOPBACK | UART_MCR_RTS);
+    uart_write(uart, UART_REG_THR, 0xAE);
+
+    for (i = 0; i < UART_PROBE_SPINS; i++) {
+        if (uart_read(uart, UART_REG_LSR) & UART_LSR_DR)
+            return uart_read(uart, UART_REG_RBR) == 0xAE;
+
+        cpu_relax();
+    }
+
+    return false;
+}
+
+error_t uart_16550_init(struct uart_16550 *uart, io_window *iow, u32 baud)
+{
+    u16 divisor;
+    u8 iir;
+
+    if (baud == 0 || baud > UART_BASE_CLOCK ||
+        UART_BASE_CLOCK % baud != 0)
+        return EINVAL;
+
+    uart->iow = iow;
+    uart->baud = baud;
+
+    uart_write(uart, UART_REG_IER, 0);
+
+    divisor = UART_BASE_CLOCK / baud;
+    uart_write(uart, UART_REG_LCR, UART_LCR_DLAB);
+    uart_write(uart, UART_REG_DLL, divisor & 0xFF);
+    uart_write(uart, UART_REG_DLM, divisor >> 8);
+
+    // 64-byte FIFO enable on 16750 is only writable with DLAB set
+    uart_write(uart, UART_REG_FCR, UART_FCR_ENABLE | UART_FCR_CLEAR_RX |
+                                   UART_FCR_CLEAR_TX | UART_FCR_64_BYTE |
+                                   UART_FCR_TRIGGER_14);
+    uart_write(uart, UART_REG_LCR, UART_LCR_8N1);
+
+    if (!uart_probe(uart))
+        return ENODEV;
+
+    uart_write(uart, UART_REG_MCR, UART_MCR_DTR | UART_MCR_RTS |
+                                   UART_MCR_OUT2);
+
+    iir = uart_read(uart, UART_REG_IIR);
+    if ((iir & UART_IIR_FIFO_MASK) != UART_IIR_FIFO_MASK)
+        uart->fifo_size = 1;
+    else if (iir & UART_IIR_FIFO_64)
+        uart->fifo_size = 64;
+    else
+        uart->fifo_size = 16;
+
+    uart->con.name = "16550 UART";
+    uart->con.write = uart_console_write;
+
+    pr_info("%u baud, %zu byte FIFO\n", baud, uart->fifo_size);
+    return EOK;
+}
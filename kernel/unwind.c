@@ -3,6 +3,7 @@
 #include <arch/private/unwind.h>
 #include <private/arch/unwind.h>
 #include <private/unwind.h>
+#include <private/unwind_table.h>
 #include <private/symbols.h>
 
 #include <log.h>
@@ -10,6 +11,7 @@
 #include <symbols.h>
 #include <leb128.h>
 
+#include <common/atomic.h>
 #include <common/string.h>
 #include <common/attributes.h>
 
@@ -39,6 +41,7 @@ enum DW_EH_PE {
 };
 
 static bool g_unwinder_available;
+static bool g_unwind_table_available;
 
 static const u8 *g_fde_binary_search_table;
 static u8 g_fde_table_encoding;
@@ -275,11 +278,53 @@ error_t unwind_init(void)
     // Multiply by 2 because each entry is made up of two values
     g_fde_table_entry_width *= 2;
 
+    if (g_unwind_table_num_registers == ARCH_NUM_DWARF_REGISTERS) {
+        g_unwind_table_available = true;
+    } else if (g_unwind_table_size) {
+        pr_warn(
+            "ignoring unwind table built for %u registers\n",
+            g_unwind_table_num_registers
+        );
+    }
+
     pr_info("stack traces are available!\n");
     g_unwinder_available = true;
     return EOK;
 }
 
+#define DW_EH_PE_DATAREL_SDATA4 (DW_EH_PE_datarel | DW_EH_PE_sdata4)
+
+static i32 read_sdata4(const u8 *cursor)
+{
+    i32 value;
+
+    memcpy(&value, cursor, sizeof(value));
+    return value;
+}
+
+/*
+ * Every toolchain we care about emits the search table as pairs of 32-bit
+ * offsets from the start of .eh_frame_hdr, search those without going through
+ * the generic decoder at every probe.
+ */
+static ptr_or_error_t find_fde_datarel_sdata4(ptr_t pc)
+{
+    const u8 *table = g_fde_binary_search_table;
+    ptr_t base = (ptr_t)LINKER_SYMBOL(eh_frame_hdr_begin);
+    u64 i, begin = 0, end = g_num_fdes;
+
+    while (end - begin > 1) {
+        i = begin + ((end - begin) / 2);
+
+        if (base + read_sdata4(&table[i * 8]) <= pc)
+            begin = i;
+        else
+            end = i;
+    }
+
+    return (void*)(base + read_sdata4(&table[begin * 8 + 4]));
+}
+
 static ptr_or_error_t find_fde(ptr_t pc)
 {
     error_t ret;
@@ -287,6 +332,9 @@ static ptr_or_error_t find_fde(ptr_t pc)
     u64 i, begin = 0, end = g_num_fdes;
     struct eh_data data;
 
+    if (likely(g_fde_table_encoding == DW_EH_PE_DATAREL_SDATA4))
+        return find_fde_datarel_sdata4(pc);
+
     while (end - begin > 1) {
         i = begin + ((end - begin) / 2);
 
@@ -374,7 +422,32 @@ bool unwind_is_done(const struct unwind_state *state)
  */
 #define EXPECTED_AUG_STRING "zR"
 
-static error_t parse_cie(struct unwind_state *state, struct eh_data *cie)
+// Everything the unwinder needs from a CIE
+struct cie_info {
+    const u8 *address;
+    u64 code_alignment_factor;
+    i64 data_alignment_factor;
+    struct eh_data code;
+    u8 ret_reg_idx;
+    u8 fde_encoding;
+    bool signal_frame;
+};
+
+/*
+ * Parsed CIEs, the kernel only has a handful of them so this never fills up
+ * in practice. Slots are claimed once and published by storing the CIE address
+ * with release semantics, they're never reused afterwards.
+ */
+#define CIE_CACHE_SIZE 8
+
+struct cie_cache_slot {
+    bool claimed;
+    struct cie_info info;
+};
+
+static struct cie_cache_slot g_cie_cache[CIE_CACHE_SIZE];
+
+static error_t parse_cie(struct cie_info *info, struct eh_data *cie)
 {
     error_t ret;
     u32 id;
@@ -406,7 +479,7 @@ static error_t parse_cie(struct unwind_state *state, struct eh_data *cie)
              *     S: signal frame (PC points to the instruction before call)
              */
             if (likely(aug_ch == 'S')) {
-                state->signal_frame = true;
+                info->signal_frame = true;
 
                 // Skip this char, pretend it never happened
                 aug_idx--;
@@ -420,12 +493,12 @@ static error_t parse_cie(struct unwind_state *state, struct eh_data *cie)
         }
     }
 
-    ret = decode_value(cie, DW_EH_PE_uleb128, &state->code_alignment_factor);
+    ret = decode_value(cie, DW_EH_PE_uleb128, &info->code_alignment_factor);
     if (is_error(ret))
         return ret;
 
     ret = decode_value(
-        cie, DW_EH_PE_sleb128, (u64*)&state->data_alignment_factor
+        cie, DW_EH_PE_sleb128, (u64*)&info->data_alignment_factor
     );
     if (is_error(ret))
         return ret;
@@ -435,7 +508,7 @@ static error_t parse_cie(struct unwind_state *state, struct eh_data *cie)
         return ret;
     if (unlikely(ret_reg >= ARCH_NUM_DWARF_REGISTERS))
         return EINVAL;
-    state->ret_reg_idx = ret_reg;
+    info->ret_reg_idx = ret_reg;
 
     ret = decode_value(cie, DW_EH_PE_uleb128, &aug_length);
     if (is_error(ret))
@@ -443,21 +516,132 @@ static error_t parse_cie(struct unwind_state *state, struct eh_data *cie)
     if (unlikely(aug_length != 1))
         return EINVAL;
 
-    ret = eh_consume(cie, state->fde_encoding);
+    ret = eh_consume(cie, info->fde_encoding);
     if (is_error(ret))
         return ret;
 
-    state->cie_code = *cie;
+    info->code = *cie;
     return EOK;
 }
 
-error_t parse_fde(struct unwind_state *state, struct eh_data *fde)
+/*
+ * Returns the parsed CIE at 'address', either from the cache or by parsing it
+ * into 'scratch' if the cache is full.
+ */
+static ptr_or_error_t get_cie(const u8 *address, struct cie_info *scratch)
 {
-    error_t ret;
+    struct cie_cache_slot *slot = NULL;
+    struct cie_info *info = scratch;
     struct eh_data cie;
+    size_t i;
+    error_t ret;
+
+    for (i = 0; i < CIE_CACHE_SIZE; i++) {
+        if (atomic_load_acquire(&g_cie_cache[i].info.address) == address)
+            return &g_cie_cache[i].info;
+    }
+
+    for (i = 0; i < CIE_CACHE_SIZE; i++) {
+        if (atomic_load_relaxed(&g_cie_cache[i].claimed) ||
+            atomic_xchg(&g_cie_cache[i].claimed, true, MO_ACQUIRE))
+            continue;
+
+        slot = &g_cie_cache[i];
+        info = &slot->info;
+        break;
+    }
+
+    memzero(info, sizeof(*info));
+    eh_data_init(&cie, address);
+
+    ret = parse_cie(info, &cie);
+    if (is_error(ret)) {
+        // Nothing has been published yet, give the slot back
+        if (slot)
+            atomic_store_release(&slot->claimed, false);
+
+        return encode_error_ptr(ret);
+    }
+
+    if (slot)
+        atomic_store_release(&info->address, address);
+
+    return info;
+}
+
+// A decoded FDE along with the CIE it belongs to
+struct fde_info {
+    ptr_t pc_begin;
+    ptr_t pc_end;
+    const struct cie_info *cie;
+    struct eh_data code;
+};
+
+/*
+ * Direct-mapped cache of decoded FDEs keyed by the PC they were looked up for,
+ * stack samples keep hitting the same few return addresses. Entries are
+ * guarded by a sequence counter that is odd while the entry is being
+ * rewritten, readers racing with a writer simply decode the FDE again.
+ */
+#define FDE_CACHE_SHIFT 7
+#define FDE_CACHE_SIZE (1 << FDE_CACHE_SHIFT)
+
+struct fde_cache_entry {
+    u32 seq;
+    struct fde_info info;
+};
+
+static struct fde_cache_entry g_fde_cache[FDE_CACHE_SIZE];
+
+static struct fde_cache_entry *fde_cache_entry(ptr_t pc)
+{
+    u64 hash = (u64)pc * 0x9E3779B97F4A7C15ull;
+
+    return &g_fde_cache[hash >> (64 - FDE_CACHE_SHIFT)];
+}
+
+static bool fde_cache_lookup(ptr_t pc, struct fde_info *out_info)
+{
+    struct fde_cache_entry *entry = fde_cache_entry(pc);
+    u32 seq;
+
+    seq = atomic_load_acquire(&entry->seq);
+    if (seq & 1)
+        return false;
+
+    memcpy(out_info, &entry->info, sizeof(*out_info));
+
+    barrier_acquire();
+    if (atomic_load_relaxed(&entry->seq) != seq)
+        return false;
+
+    return out_info->cie != NULL &&
+           pc >= out_info->pc_begin && pc < out_info->pc_end;
+}
+
+static void fde_cache_insert(ptr_t pc, const struct fde_info *info)
+{
+    struct fde_cache_entry *entry = fde_cache_entry(pc);
+    u32 seq;
+
+    seq = atomic_load_relaxed(&entry->seq);
+    if ((seq & 1) || !atomic_cmpxchg_acq_rel(&entry->seq, seq, seq + 1))
+        return;
+
+    memcpy(&entry->info, info, sizeof(*info));
+    atomic_store_release(&entry->seq, seq + 2);
+}
+
+static error_t parse_fde(
+    struct eh_data *fde, struct cie_info *cie_scratch,
+    struct fde_info *out_info
+)
+{
+    error_t ret;
+    ptr_or_error_t pret;
+    const struct cie_info *cie;
     u32 cie_offset;
-    ptr_t current_pc;
-    u64 pc_size;
+    u64 pc_begin, pc_size;
     u8 aug_length;
 
     /*
@@ -472,12 +656,12 @@ error_t parse_fde(struct unwind_state *state, struct eh_data *fde)
     if (unlikely(cie_offset == 0))
         return EINVAL;
 
-    eh_data_init(&cie, fde->cursor - cie_offset - sizeof(cie_offset));
-    ret = parse_cie(state, &cie);
-    if (is_error(ret))
-        return ret;
+    pret = get_cie(fde->cursor - cie_offset - sizeof(cie_offset), cie_scratch);
+    if (error_ptr(pret))
+        return decode_error_ptr(pret);
+    cie = pret;
 
-    ret = decode_value(fde, state->fde_encoding, &state->pc);
+    ret = decode_value(fde, cie->fde_encoding, &pc_begin);
     if (is_error(ret))
         return ret;
 
@@ -487,22 +671,22 @@ error_t parse_fde(struct unwind_state *state, struct eh_data *fde)
      * as being encoded in the same way as 'pc_begin', but absolute (aka with
      * top 4 bits of encoding masked).
      */
-    ret = decode_value(fde, state->fde_encoding & 0x0F, &pc_size);
+    ret = decode_value(fde, cie->fde_encoding & 0x0F, &pc_size);
     if (is_error(ret))
         return ret;
 
-    current_pc = get_reliable_pc(state);
-    if (unlikely(current_pc < state->pc ||
-                 current_pc >= (state->pc + pc_size)))
-        return EINVAL;
-
     ret = eh_consume(fde, aug_length);
     if (is_error(ret))
         return ret;
     if (unlikely(aug_length != 0))
         return ENOSYS;
 
-    state->fde_code = *fde;
+    *out_info = (struct fde_info) {
+        .pc_begin = pc_begin,
+        .pc_end = pc_begin + pc_size,
+        .cie = cie,
+        .code = *fde,
+    };
     return EOK;
 }
 
@@ -510,14 +694,45 @@ static error_t prepare_unwind_state(struct unwind_state *state)
 {
     ptr_or_error_t pret;
     struct eh_data fde;
+    struct fde_info info;
+    struct cie_info cie_scratch;
+    ptr_t lookup_pc, current_pc;
+    error_t ret;
 
-    pret = find_fde(get_reliable_pc(state));
-    if (error_ptr(pret))
-        return decode_error_ptr(pret);
+    lookup_pc = get_reliable_pc(state);
+
+    if (!fde_cache_lookup(lookup_pc, &info)) {
+        pret = find_fde(lookup_pc);
+        if (error_ptr(pret))
+            return decode_error_ptr(pret);
+
+        eh_data_init(&fde, pret);
 
-    eh_data_init(&fde, pret);
+        ret = parse_fde(&fde, &cie_scratch, &info);
+        if (is_error(ret))
+            return ret;
+
+        // Only cache FDEs whose CIE is cached as well
+        if (info.cie != &cie_scratch)
+            fde_cache_insert(lookup_pc, &info);
+    }
 
-    return parse_fde(state, &fde);
+    if (info.cie->signal_frame)
+        state->signal_frame = true;
+
+    current_pc = get_reliable_pc(state);
+    if (unlikely(current_pc < info.pc_begin || current_pc >= info.pc_end))
+        return EINVAL;
+
+    state->pc = info.pc_begin;
+    state->pc_end = info.pc_end;
+    state->code_alignment_factor = info.cie->code_alignment_factor;
+    state->data_alignment_factor = info.cie->data_alignment_factor;
+    state->ret_reg_idx = info.cie->ret_reg_idx;
+    state->fde_encoding = info.cie->fde_encoding;
+    state->cie_code = info.cie->code;
+    state->fde_code = info.code;
+    return EOK;
 }
 
 #define HIGH_2_BITS_OP(x) ((x) << 6)
@@ -689,16 +904,89 @@ static error_t apply_reg_rules(
     return EOK;
 }
 
+/*
+ * Returns the precompiled rule covering 'pc', or NULL if the frame has to be
+ * unwound by interpreting .eh_frame instead.
+ */
+static const struct unwind_table_rule *unwind_table_find(ptr_t pc)
+{
+    ptr_t offset;
+    u32 i, begin = 0, end = g_unwind_table_size;
+    u16 rule_idx;
+
+    if (!g_unwind_table_available || end == 0 ||
+        pc < (ptr_t)LINKER_SYMBOL(text_begin))
+        return NULL;
+
+    offset = pc - (ptr_t)LINKER_SYMBOL(text_begin);
+    if (offset < g_unwind_table_pcs[0])
+        return NULL;
+
+    while (end - begin > 1) {
+        i = begin + ((end - begin) / 2);
+
+        if (g_unwind_table_pcs[i] <= offset)
+            begin = i;
+        else
+            end = i;
+    }
+
+    rule_idx = g_unwind_table_rule_indices[begin];
+    if (rule_idx == UNWIND_TABLE_NO_RULE)
+        return NULL;
+
+    return &g_unwind_table_rules[rule_idx];
+}
+
+static void unwind_table_apply(
+    struct unwind_state *state, ptr_t *new_frame,
+    const struct unwind_table_rule *rule
+)
+{
+    size_t i;
+    ptr_t cfa;
+
+    cfa = state->frame[rule->cfa_reg] + rule->cfa_offset;
+
+    for (i = 0; i < ARCH_NUM_DWARF_REGISTERS; i++) {
+        if (!rule->reg_offsets[i]) {
+            new_frame[i] = state->frame[i];
+            continue;
+        }
+
+        memcpy(
+            &new_frame[i], (void*)(cfa + rule->reg_offsets[i]), sizeof(ptr_t)
+        );
+    }
+
+    if (!rule->reg_offsets[DWARF_SP_REG])
+        new_frame[DWARF_SP_REG] = cfa;
+
+    state->ret_reg_idx = rule->ret_reg;
+}
+
 error_t unwind_next_frame(struct unwind_state *state)
 {
     error_t ret;
     size_t i;
     ptr_t new_frame[ARCH_NUM_DWARF_REGISTERS];
     struct register_rule reg_rules[ARCH_NUM_DWARF_REGISTERS];
+    const struct unwind_table_rule *table_rule;
 
     if (unlikely(state->end))
         return EINVAL;
 
+    /*
+     * Looked up with the same adjusted PC used to find the FDE, the table
+     * never covers FDEs of signal frames.
+     */
+    table_rule = unwind_table_find(get_reliable_pc(state));
+    if (likely(table_rule != NULL)) {
+        unwind_table_apply(state, new_frame, table_rule);
+        state->signal_frame = false;
+        goto out_frame_done;
+    }
+
     ret = prepare_unwind_state(state);
     if (is_error(ret))
         goto out_error;
@@ -724,6 +1012,7 @@ error_t unwind_next_frame(struct unwind_state *state)
     if (is_error(ret))
         goto out_error;
 
+out_frame_done:
     memcpy(state->frame, new_frame, sizeof(state->frame));
     state->end = unwind_get_return_address(state) == 0;
     return EOK;
@@ -10,8 +10,10 @@
 import argparse
 import subprocess
 import functools
+import hashlib
+import json
 from dataclasses import dataclass
-from typing import List, Tuple, Optional
+from typing import Dict, List, Tuple, Optional
 from types import TracebackType
 from enum import Enum
 from abc import ABC, abstractmethod
@@ -343,16 +345,34 @@ def make_context(mode: Mode, binary_path: Optional[str]) -> Context:
     }[mode](binary_path)
 
 
+class InternStrategy(Enum):
+    # Greedy most frequent pair, identical to scripts/kallsyms.c
+    LINUX = 1
+
+    # Greedy pair with the best net saving, where occurrences that overlap
+    # (e.g. "aaa") are only counted once and the bytes the new token occupies
+    # in the token table are taken into account
+    NET_SAVING = 2
+
+
 class TokenTable:
     class TokenizedSymbol:
         def __init__(self, symbol: Symbol):
             self.tokens: List[int] = [ord(c) for c in symbol.canonical_name()]
 
-    def __init__(self, symbols: List[Symbol]) -> None:
+    def __init__(
+        self, symbols: List[Symbol],
+        strategy: InternStrategy = InternStrategy.LINUX,
+        refine_passes: int = 0
+    ) -> None:
         self.symbols = [TokenTable.TokenizedSymbol(s) for s in symbols]
+        self.strategy = strategy
 
-        # This stores two-byte sequences and we want to have O(1) lookups
-        self.multibyte_tokens: List[int] = [0] * 0x10000  # (UINT16_MAX + 1)
+        # Occurrence counts of two-token sequences, indexed by
+        # (second << 8) | first. Only pairs that currently occur are stored,
+        # which keeps the search for the best pair proportional to the number
+        # of distinct pairs rather than all 64K of them.
+        self.multibyte_tokens: Dict[int, int] = {}
 
         # Top 256 tokens that will end up in kallsyms
         #
@@ -361,21 +381,46 @@ class TokenTable:
         # Otherwise it's a compound token consisting of two sub-tokens
         self.best_tokens: List[List[int]] = [[]] * 0x100  # (UINT8_MAX + 1)
 
+        # Length of every token once fully expanded into a string
+        self.token_lengths: List[int] = [0] * 0x100
+
         for symbol in self.symbols:
             self.__add_symbol(symbol, record_for_best=True)
 
         self.__optimize()
 
+        for _ in range(refine_passes):
+            if not self.__refine():
+                break
+
     def __for_each_token(self, symbol: TokenizedSymbol, addend: int,
                          record_for_best: bool = False) -> None:
+        count_overlaps = self.strategy == InternStrategy.LINUX
+        last_counted_pair = -1
+        last_counted_idx = -1
+
         for i in range(0, len(symbol.tokens) - 1):
-            self.multibyte_tokens[
-                (symbol.tokens[i + 1] << 8) + symbol.tokens[i]
-            ] += addend
+            pair = (symbol.tokens[i + 1] << 8) + symbol.tokens[i]
+
+            # Only one of two overlapping occurrences can ever be substituted
+            if (not count_overlaps and pair == last_counted_pair and
+               last_counted_idx == i - 1):
+                last_counted_idx = -1
+                continue
+
+            count = self.multibyte_tokens.get(pair, 0) + addend
+            if count:
+                self.multibyte_tokens[pair] = count
+            else:
+                del self.multibyte_tokens[pair]
+
+            last_counted_pair = pair
+            last_counted_idx = i
 
         if record_for_best:
             for token in symbol.tokens:
                 self.best_tokens[token] = [token]
+                self.token_lengths[token] = 1
 
     def __add_symbol(
         self, symbol: TokenizedSymbol, record_for_best: bool = False
@@ -385,18 +430,26 @@ class TokenTable:
     def __remove_symbol(self, symbol: TokenizedSymbol) -> None:
         self.__for_each_token(symbol, -1)
 
-    def __most_used_multibyte_token(self) -> Tuple[int, int]:
-        best_score = -1
-        best_index = 0
+    def __pair_score(self, pair: int, count: int) -> int:
+        if self.strategy == InternStrategy.LINUX:
+            return count
 
-        for i, score in enumerate(self.multibyte_tokens):
-            if score <= best_score:
-                continue
+        # Each substitution saves a byte, the new token costs its length
+        return count - (self.token_lengths[pair & 0xFF] +
+                        self.token_lengths[pair >> 8])
 
-            best_score = score
-            best_index = i
+    def __most_used_multibyte_token(self) -> Tuple[int, int]:
+        if not self.multibyte_tokens:
+            return (0, 0)
+
+        # Ties go to the lowest pair index, same as a linear scan would
+        best_index, best_score = max(
+            ((i, self.__pair_score(i, count))
+             for i, count in self.multibyte_tokens.items()),
+            key=lambda entry: (entry[1], -entry[0])
+        )
 
-        return (best_index, best_score)
+        return (best_index, max(best_score, 0))
 
     def __compress_with_compound_token(self, idx: int) -> None:
         tgt_token = self.best_tokens[idx]
@@ -437,9 +490,108 @@ class TokenTable:
                 (most_used[0] >> 0) & 0xFF,
                 (most_used[0] >> 8) & 0xFF
             ]
+            self.token_lengths[i] = sum(
+                self.token_lengths[t] for t in self.best_tokens[i]
+            )
 
             self.__compress_with_compound_token(i)
 
+    def __expand_token(self, idx: int) -> None:
+        expansion = self.best_tokens[idx]
+
+        def splice(tokens: List[int]) -> List[int]:
+            out: List[int] = []
+
+            for token in tokens:
+                out.extend(expansion if token == idx else [token])
+
+            return out
+
+        for symbol in self.symbols:
+            if idx not in symbol.tokens:
+                continue
+
+            self.__remove_symbol(symbol)
+            symbol.tokens = splice(symbol.tokens)
+            self.__add_symbol(symbol)
+
+        # Other compound tokens may be built on top of this one
+        for i, token in enumerate(self.best_tokens):
+            if len(token) > 1 and idx in token:
+                self.best_tokens[i] = splice(token)
+
+        self.best_tokens[idx] = []
+        self.token_lengths[idx] = 0
+
+    # Frees every compound token that no longer pays for the space it takes
+    # up in the token table, typically because later tokens swallowed most of
+    # its uses, and hands the slots out again. Returns False if that didn't
+    # make the tables any smaller, in which case nothing is changed.
+    def __refine(self) -> bool:
+        snapshot = (
+            [list(s.tokens) for s in self.symbols],
+            [list(t) for t in self.best_tokens],
+            list(self.token_lengths),
+            dict(self.multibyte_tokens),
+        )
+        size_before = self.compressed_size()
+
+        uses = [0] * 0x100
+        for symbol in self.symbols:
+            for token in symbol.tokens:
+                uses[token] += 1
+
+        freed = 0
+        for i, token in enumerate(self.best_tokens):
+            if len(token) > 1 and uses[i] <= self.token_lengths[i]:
+                self.__expand_token(i)
+                freed += 1
+
+        if freed:
+            self.__optimize()
+            if self.compressed_size() < size_before:
+                return True
+
+        for symbol, tokens in zip(self.symbols, snapshot[0]):
+            symbol.tokens = tokens
+        (_, self.best_tokens, self.token_lengths,
+         self.multibyte_tokens) = snapshot
+        return False
+
+    # Rebuilds a table from the result of a previous run over the same names
+    @staticmethod
+    def from_interned(
+        symbols: List[Symbol], strategy: InternStrategy,
+        best_tokens: List[List[int]], name_tokens: Dict[str, List[int]]
+    ) -> 'TokenTable':
+        table = TokenTable.__new__(TokenTable)
+        table.strategy = strategy
+        table.multibyte_tokens = {}
+        table.best_tokens = best_tokens
+        table.token_lengths = [
+            len(table.unwind_compound(token)) if token else 0
+            for token in best_tokens
+        ]
+        table.symbols = []
+
+        for symbol in symbols:
+            tokenized = TokenTable.TokenizedSymbol(symbol)
+            tokenized.tokens = list(name_tokens[symbol.canonical_name()])
+            table.symbols.append(tokenized)
+
+        return table
+
+    # Size of the compressed names and the token table in bytes
+    def compressed_size(self) -> int:
+        names = sum(
+            len(s.tokens) + (1 if len(s.tokens) <= leb128_max(1) else 2)
+            for s in self.symbols
+        )
+        tokens = sum(length + 1 for length in self.token_lengths)
+        offsets = len(self.token_lengths) * 2
+
+        return names + tokens + offsets
+
     def unwind_compound(self, tokens: List[int]) -> str:
         out_str = ""
 
@@ -498,6 +650,10 @@ class TableType(Enum):
     SYMBOL_INDICES = 5
     TOKEN_TABLE = 6
     TOKEN_OFFSETS = 7
+    SYMBOL_MARKER_SHIFT = 8
+    ADDRESS_INDEX = 9
+    ADDRESS_INDEX_SIZE = 10
+    ADDRESS_INDEX_SHIFT = 11
 
 
 class TableGenerator(ABC):
@@ -582,6 +738,10 @@ class CGenerator(TableGenerator):
             TableType.SYMBOL_INDICES: "name_index_to_address_index",
             TableType.TOKEN_TABLE: "token_table",
             TableType.TOKEN_OFFSETS: "token_offsets",
+            TableType.SYMBOL_MARKER_SHIFT: "name_offset_shift",
+            TableType.ADDRESS_INDEX: "address_index",
+            TableType.ADDRESS_INDEX_SIZE: "address_index_size",
+            TableType.ADDRESS_INDEX_SHIFT: "address_index_shift",
         }[table_type]
 
     def _emit_label(
@@ -794,6 +954,91 @@ class GASGenerator(TableGenerator):
         return GASGenerator.ArrayEmitter(self, table_type, type)
 
 
+# The interned token table only depends on the set of symbol names, which
+# rarely changes between link stages or incremental builds, while interning is
+# by far the most expensive part of generating the tables. Cache it keyed by
+# the names and the interning parameters.
+TOKEN_CACHE_VERSION = 1
+
+
+def token_cache_key(
+    symbols: List[Symbol], strategy: InternStrategy, refine_passes: int
+) -> str:
+    digest = hashlib.sha256()
+    digest.update(f"{TOKEN_CACHE_VERSION}:{strategy.name}:{refine_passes}\n"
+                  .encode())
+
+    for name in sorted(s.canonical_name() for s in symbols):
+        digest.update(name.encode())
+        digest.update(b"\n")
+
+    return digest.hexdigest()
+
+
+def make_token_table(
+    symbols: List[Symbol], strategy: InternStrategy, refine_passes: int,
+    cache_path: Optional[str]
+) -> TokenTable:
+    key = token_cache_key(symbols, strategy, refine_passes)
+
+    if cache_path:
+        try:
+            with open(cache_path, "r") as cache_file:
+                cache = json.load(cache_file)
+
+            if cache["key"] == key:
+                return TokenTable.from_interned(
+                    symbols, strategy, cache["best_tokens"], cache["names"]
+                )
+        except (OSError, ValueError, KeyError):
+            pass
+
+    token_table = TokenTable(symbols, strategy, refine_passes)
+
+    if cache_path:
+        with open(cache_path, "w") as cache_file:
+            json.dump({
+                "key": key,
+                "best_tokens": token_table.best_tokens,
+                "names": {
+                    symbol.canonical_name(): tokenized.tokens
+                    for symbol, tokenized in zip(symbols, token_table.symbols)
+                },
+            }, cache_file)
+
+    return token_table
+
+
+# Linux always places a name marker every 256 symbols
+LINUX_NAME_MARKER_INTERVAL = 256
+
+# Granularity of the address index, one entry per page of .text
+ADDRESS_INDEX_SHIFT = 12
+
+
+# For every page spanned by the symbols, find the index of the last symbol
+# starting at or before the beginning of that page. Any address within page
+# N then belongs to one of the symbols in [index[N], index[N + 1]].
+def build_address_index(relative_addresses: List[int]) -> List[int]:
+    if not relative_addresses:
+        return []
+
+    num_pages = (relative_addresses[-1] >> ADDRESS_INDEX_SHIFT) + 1
+    index: List[int] = []
+    i = 0
+
+    for page in range(num_pages):
+        page_start = page << ADDRESS_INDEX_SHIFT
+
+        while (i + 1 < len(relative_addresses) and
+               relative_addresses[i + 1] <= page_start):
+            i += 1
+
+        index.append(i)
+
+    return index
+
+
 def main() -> None:
     parser = argparse.ArgumentParser("Generate the kernel symbol tables")
     parser.add_argument("out_file", help="Target to output the symbol tables")
@@ -803,13 +1048,48 @@ def main() -> None:
     parser.add_argument("--linux-mode", action="store_true",
                         help="Enables GAS backend & linux-specific symbols"
                              " (fully compatible with kallsyms)")
+    parser.add_argument("--refine-passes", type=int, default=4,
+                        help="Maximum number of passes that free tokens "
+                             "which don't pay for themselves and intern new "
+                             "ones in their place (ignored in linux mode)")
+    parser.add_argument("--cache",
+                        help="File to cache the interned token table in, "
+                             "reused as long as the symbol names don't "
+                             "change")
+    parser.add_argument("--stats", action="store_true",
+                        help="Print the achieved compression ratio")
+    parser.add_argument("--name-marker-interval", type=int, default=32,
+                        choices=[16, 32, 64, 128, 256],
+                        help="Number of symbols between name offset markers, "
+                             "bounds the number of names skipped per lookup "
+                             "(always 256 in linux mode)")
     args = parser.parse_args()
 
     ctx = make_context(
         Mode.LINUX if args.linux_mode else Mode.ULTRA,
         args.binary
     )
-    token_table = TokenTable(ctx.symbols)
+    if args.linux_mode:
+        token_table = make_token_table(
+            ctx.symbols, InternStrategy.LINUX, 0, args.cache
+        )
+    else:
+        token_table = make_token_table(
+            ctx.symbols, InternStrategy.NET_SAVING, args.refine_passes,
+            args.cache
+        )
+
+    if args.stats:
+        raw_size = sum(len(s.canonical_name()) + 1 for s in ctx.symbols)
+        compressed_size = token_table.compressed_size()
+
+        print(f"{len(ctx.symbols)} symbols, names: {raw_size} bytes raw, "
+              f"{compressed_size} bytes compressed including the token "
+              f"table ({compressed_size / max(raw_size, 1):.1%})")
+
+    marker_interval = args.name_marker_interval
+    if args.linux_mode:
+        marker_interval = LINUX_NAME_MARKER_INTERVAL
 
     byte_offset = 0
     offset_markers: List[int] = []
@@ -819,7 +1099,7 @@ def main() -> None:
 
         with gen.array(TableType.SYMBOL_NAMES, ValueType.U8_ARRAY) as arr:
             for idx, tokenized_symbol in enumerate(token_table.symbols):
-                if (idx & 0xFF) == 0:
+                if (idx % marker_interval) == 0:
                     offset_markers.append(byte_offset)
 
                 ctx.symbols[idx].index = idx
@@ -847,6 +1127,12 @@ def main() -> None:
             for marker in offset_markers:
                 arr.emit(Value.u32(marker))
 
+        if not args.linux_mode:
+            gen.emit(
+                TableType.SYMBOL_MARKER_SHIFT,
+                Value.u32(marker_interval.bit_length() - 1)
+            )
+
         byte_offset = 0
         offset_markers.clear()
 
@@ -874,6 +1160,23 @@ def main() -> None:
         first_symbol_offset = first_symbol_address - ctx.start_of_text()
         gen.emit(TableType.SYMBOL_BASE, Value.u32(first_symbol_offset))
 
+        if not args.linux_mode:
+            address_index = build_address_index([
+                symbol.address - first_symbol_address
+                for symbol in ctx.symbols
+            ])
+
+            with gen.array(TableType.ADDRESS_INDEX, ValueType.U32) as arr:
+                for symbol_index in address_index:
+                    arr.emit(Value.u32(symbol_index))
+
+            gen.emit(
+                TableType.ADDRESS_INDEX_SIZE, Value.u32(len(address_index))
+            )
+            gen.emit(
+                TableType.ADDRESS_INDEX_SHIFT, Value.u32(ADDRESS_INDEX_SHIFT)
+            )
+
         ctx.sort_by_name()
 
         with gen.array(TableType.SYMBOL_INDICES, ValueType.U8_ARRAY) as arr:
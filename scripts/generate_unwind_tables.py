@@ -0,0 +1,633 @@
+#!/usr/bin/python3
+#
+# Generate precompiled kernel unwind tables
+#
+# Evaluates the DWARF call frame information in .eh_frame ahead of time and
+# flattens it into a sorted table of rows, one per change in the unwind rules,
+# so that the kernel unwinder only has to binary search the table and do a few
+# loads per frame instead of interpreting CIE/FDE bytecode. FDEs that can't be
+# expressed as a table row are left out and unwound via .eh_frame at runtime.
+#
+
+import argparse
+import struct
+import subprocess
+from dataclasses import dataclass, field
+from typing import Dict, List, Optional, Tuple
+
+
+# Must match ARCH_NUM_DWARF_REGISTERS of the respective architecture
+NUM_DWARF_REGISTERS = {
+    3: 17,    # EM_386
+    62: 17,   # EM_X86_64
+    183: 33,  # EM_AARCH64
+}
+
+TEXT_BEGIN_SYMBOL = "g_linker_symbol_text_begin"
+
+# Marks a range of .text that is not covered by the table
+NO_RULE = 0xFFFF
+
+I16_MIN, I16_MAX = -(1 << 15), (1 << 15) - 1
+I32_MIN, I32_MAX = -(1 << 31), (1 << 31) - 1
+
+DW_EH_PE_pcrel = 0x10
+
+DW_CFA_advance_loc = 0x40
+DW_CFA_offset = 0x80
+DW_CFA_restore = 0xC0
+
+DW_CFA_nop = 0x00
+DW_CFA_advance_loc1 = 0x02
+DW_CFA_advance_loc2 = 0x03
+DW_CFA_advance_loc4 = 0x04
+DW_CFA_offset_extended = 0x05
+DW_CFA_restore_extended = 0x06
+DW_CFA_same_value = 0x08
+DW_CFA_remember_state = 0x0A
+DW_CFA_restore_state = 0x0B
+DW_CFA_def_cfa = 0x0C
+DW_CFA_def_cfa_register = 0x0D
+DW_CFA_def_cfa_offset = 0x0E
+DW_CFA_offset_extended_sf = 0x11
+DW_CFA_def_cfa_sf = 0x12
+DW_CFA_def_cfa_offset_sf = 0x13
+DW_CFA_GNU_args_size = 0x2E
+
+
+class Unsupported(Exception):
+    pass
+
+
+class Reader:
+    def __init__(self, data: bytes, offset: int, end: int) -> None:
+        self.data = data
+        self.offset = offset
+        self.end = end
+
+    def done(self) -> bool:
+        return self.offset >= self.end
+
+    def __unpack(self, fmt: str) -> int:
+        size = struct.calcsize(fmt)
+        if self.offset + size > self.end:
+            raise Unsupported("read past the end of the entry")
+
+        value = struct.unpack_from(fmt, self.data, self.offset)[0]
+        self.offset += size
+        return value
+
+    def u8(self) -> int:
+        return self.__unpack("<B")
+
+    def u16(self) -> int:
+        return self.__unpack("<H")
+
+    def u32(self) -> int:
+        return self.__unpack("<I")
+
+    def u64(self) -> int:
+        return self.__unpack("<Q")
+
+    def i16(self) -> int:
+        return self.__unpack("<h")
+
+    def i32(self) -> int:
+        return self.__unpack("<i")
+
+    def i64(self) -> int:
+        return self.__unpack("<q")
+
+    def uleb128(self) -> int:
+        value, shift = 0, 0
+
+        while True:
+            byte = self.u8()
+            value |= (byte & 0x7F) << shift
+            shift += 7
+
+            if not byte & 0x80:
+                return value
+
+    def sleb128(self) -> int:
+        value, shift = 0, 0
+
+        while True:
+            byte = self.u8()
+            value |= (byte & 0x7F) << shift
+            shift += 7
+
+            if not byte & 0x80:
+                break
+
+        if byte & 0x40:
+            value -= 1 << shift
+
+        return value
+
+    def cstring(self) -> str:
+        end = self.data.index(b"\0", self.offset, self.end)
+        value = self.data[self.offset:end].decode()
+        self.offset = end + 1
+        return value
+
+
+@dataclass
+class Section:
+    address: int
+    data: bytes
+
+
+class ElfFile:
+    def __init__(self, path: str) -> None:
+        with open(path, "rb") as f:
+            self.data = f.read()
+
+        if self.data[:4] != b"\x7fELF":
+            raise RuntimeError(f"{path} is not an ELF file")
+        if self.data[5] != 1:
+            raise RuntimeError("only little-endian binaries are supported")
+
+        self.is_64bit = self.data[4] == 2
+        self.pointer_size = 8 if self.is_64bit else 4
+        self.machine = struct.unpack_from("<H", self.data, 18)[0]
+        self.sections = self.__read_sections()
+
+    def __read_sections(self) -> Dict[str, Section]:
+        if self.is_64bit:
+            shoff = struct.unpack_from("<Q", self.data, 0x28)[0]
+            shentsize, shnum, shstrndx = \
+                struct.unpack_from("<HHH", self.data, 0x3A)
+            fmt = "<IIQQQQ"
+        else:
+            shoff = struct.unpack_from("<I", self.data, 0x20)[0]
+            shentsize, shnum, shstrndx = \
+                struct.unpack_from("<HHH", self.data, 0x2E)
+            fmt = "<IIIIII"
+
+        # name, type, flags, address, offset, size
+        headers = [
+            struct.unpack_from(fmt, self.data, shoff + i * shentsize)
+            for i in range(shnum)
+        ]
+        strtab_offset = headers[shstrndx][4]
+
+        sections: Dict[str, Section] = {}
+        for name_offset, _, _, address, offset, size in headers:
+            name_end = self.data.index(b"\0", strtab_offset + name_offset)
+            name = self.data[strtab_offset + name_offset:name_end].decode()
+            sections[name] = Section(address, self.data[offset:offset + size])
+
+        return sections
+
+
+@dataclass
+class Rules:
+    cfa_reg: int = 0
+    cfa_offset: int = 0
+
+    # Register -> CFA-relative byte offset the register is saved at
+    offsets: Dict[int, int] = field(default_factory=dict)
+
+    def copy(self) -> 'Rules':
+        return Rules(self.cfa_reg, self.cfa_offset, dict(self.offsets))
+
+
+@dataclass
+class Cie:
+    code_alignment_factor: int
+    data_alignment_factor: int
+    ret_reg: int
+    fde_encoding: int
+    has_augmentation_data: bool
+    signal_frame: bool
+    initial_rules: Optional[Rules] = None
+
+
+@dataclass
+class Fde:
+    pc_begin: int
+    pc_end: int
+    ret_reg: int
+
+    # (pc, rules in effect from that pc onwards), empty if not representable
+    rows: List[Tuple[int, Rules]]
+
+
+class EhFrameParser:
+    def __init__(self, elf: ElfFile) -> None:
+        self.__elf = elf
+        self.__num_registers = NUM_DWARF_REGISTERS[elf.machine]
+
+        eh_frame = elf.sections[".eh_frame"]
+        self.__data = eh_frame.data
+        self.__address = eh_frame.address
+        self.__cies: Dict[int, Cie] = {}
+
+    def __read_encoded(self, reader: Reader, encoding: int) -> int:
+        pc = self.__address + reader.offset
+        fmt = encoding & 0x0F
+
+        if fmt == 0x00:
+            value = reader.u64() if self.__elf.is_64bit else reader.u32()
+        else:
+            value = {
+                0x01: reader.uleb128,
+                0x02: reader.u16,
+                0x03: reader.u32,
+                0x04: reader.u64,
+                0x09: reader.sleb128,
+                0x0A: reader.i16,
+                0x0B: reader.i32,
+                0x0C: reader.i64,
+            }.get(fmt, lambda: None)()
+
+        if value is None:
+            raise Unsupported(f"pointer format 0x{fmt:02X}")
+
+        application = encoding & 0x70
+        if application == DW_EH_PE_pcrel:
+            value += pc
+        elif application != 0:
+            raise Unsupported(f"pointer application 0x{application:02X}")
+
+        return value & ((1 << (self.__elf.pointer_size * 8)) - 1)
+
+    def __parse_cie(self, reader: Reader) -> Cie:
+        version = reader.u8()
+        if version != 1:
+            raise Unsupported(f"CIE version {version}")
+
+        augmentation = reader.cstring()
+        code_alignment_factor = reader.uleb128()
+        data_alignment_factor = reader.sleb128()
+        ret_reg = reader.uleb128()
+
+        cie = Cie(
+            code_alignment_factor, data_alignment_factor, ret_reg,
+            fde_encoding=0, has_augmentation_data=False, signal_frame=False
+        )
+
+        if augmentation.startswith("z"):
+            cie.has_augmentation_data = True
+            aug_end = reader.uleb128() + reader.offset
+
+            for ch in augmentation[1:]:
+                if ch == "R":
+                    cie.fde_encoding = reader.u8()
+                elif ch == "L":
+                    reader.u8()
+                elif ch == "P":
+                    self.__read_encoded(reader, reader.u8() & 0x7F)
+                elif ch == "S":
+                    cie.signal_frame = True
+                else:
+                    raise Unsupported(f"augmentation '{augmentation}'")
+
+            reader.offset = aug_end
+        elif augmentation:
+            raise Unsupported(f"augmentation '{augmentation}'")
+
+        if cie.ret_reg >= self.__num_registers:
+            raise Unsupported(f"return address register {cie.ret_reg}")
+
+        # The CIE instructions run before every FDE, evaluate them once
+        cie.initial_rules = Rules()
+        self.__execute(cie, reader, cie.initial_rules, 0, None)
+        return cie
+
+    def __set_offset(
+        self, rules: Rules, reg: int, factored_offset: int, cie: Cie
+    ) -> None:
+        # Like the kernel interpreter, ignore registers it doesn't track
+        if reg >= self.__num_registers:
+            return
+
+        offset = factored_offset * cie.data_alignment_factor
+        if offset == 0 or not I16_MIN <= offset <= I16_MAX:
+            raise Unsupported(f"register {reg} saved at CFA{offset:+}")
+
+        rules.offsets[reg] = offset
+
+    def __restore(self, rules: Rules, reg: int, cie: Cie) -> None:
+        assert cie.initial_rules
+
+        if reg in cie.initial_rules.offsets:
+            rules.offsets[reg] = cie.initial_rules.offsets[reg]
+        else:
+            rules.offsets.pop(reg, None)
+
+    def __def_cfa_register(self, rules: Rules, reg: int) -> None:
+        if reg >= self.__num_registers:
+            raise Unsupported(f"CFA register {reg}")
+
+        rules.cfa_reg = reg
+
+    # Executes CFA instructions, appending a row to 'rows' at every location
+    def __execute(
+        self, cie: Cie, reader: Reader, rules: Rules, pc: int,
+        rows: Optional[List[Tuple[int, Rules]]]
+    ) -> None:
+        remembered: List[Rules] = []
+
+        def advance(delta: int) -> None:
+            nonlocal pc
+
+            if rows is None:
+                raise Unsupported("advance_loc in a CIE")
+
+            rows.append((pc, rules.copy()))
+            pc += delta * cie.code_alignment_factor
+
+        while not reader.done():
+            opcode = reader.u8()
+            high, low = opcode & 0xC0, opcode & 0x3F
+
+            if high == DW_CFA_advance_loc:
+                advance(low)
+            elif high == DW_CFA_offset:
+                self.__set_offset(rules, low, reader.uleb128(), cie)
+            elif high == DW_CFA_restore:
+                self.__restore(rules, low, cie)
+            elif opcode == DW_CFA_nop:
+                continue
+            elif opcode == DW_CFA_advance_loc1:
+                advance(reader.u8())
+            elif opcode == DW_CFA_advance_loc2:
+                advance(reader.u16())
+            elif opcode == DW_CFA_advance_loc4:
+                advance(reader.u32())
+            elif opcode == DW_CFA_offset_extended:
+                reg = reader.uleb128()
+                self.__set_offset(rules, reg, reader.uleb128(), cie)
+            elif opcode == DW_CFA_offset_extended_sf:
+                reg = reader.uleb128()
+                self.__set_offset(rules, reg, reader.sleb128(), cie)
+            elif opcode == DW_CFA_restore_extended:
+                self.__restore(rules, reader.uleb128(), cie)
+            elif opcode == DW_CFA_same_value:
+                rules.offsets.pop(reader.uleb128(), None)
+            elif opcode == DW_CFA_remember_state:
+                remembered.append(rules.copy())
+            elif opcode == DW_CFA_restore_state:
+                if not remembered:
+                    raise Unsupported("restore_state without remember_state")
+
+                # Keep the object identity, 'rules' is owned by the caller
+                saved = remembered.pop()
+                rules.cfa_reg = saved.cfa_reg
+                rules.cfa_offset = saved.cfa_offset
+                rules.offsets = saved.offsets
+            elif opcode == DW_CFA_def_cfa:
+                self.__def_cfa_register(rules, reader.uleb128())
+                rules.cfa_offset = reader.uleb128()
+            elif opcode == DW_CFA_def_cfa_sf:
+                self.__def_cfa_register(rules, reader.uleb128())
+                rules.cfa_offset = \
+                    reader.sleb128() * cie.data_alignment_factor
+            elif opcode == DW_CFA_def_cfa_register:
+                self.__def_cfa_register(rules, reader.uleb128())
+            elif opcode == DW_CFA_def_cfa_offset:
+                rules.cfa_offset = reader.uleb128()
+            elif opcode == DW_CFA_def_cfa_offset_sf:
+                rules.cfa_offset = \
+                    reader.sleb128() * cie.data_alignment_factor
+            elif opcode == DW_CFA_GNU_args_size:
+                reader.uleb128()
+            else:
+                raise Unsupported(f"CFA opcode 0x{opcode:02X}")
+
+            if not I32_MIN <= rules.cfa_offset <= I32_MAX:
+                raise Unsupported(f"CFA offset {rules.cfa_offset}")
+
+        if rows is not None:
+            rows.append((pc, rules.copy()))
+
+    def __get_cie(self, offset: int) -> Cie:
+        if offset not in self.__cies:
+            length = struct.unpack_from("<I", self.__data, offset)[0]
+            if length == 0xFFFFFFFF:
+                raise Unsupported("64-bit DWARF CIE")
+
+            reader = Reader(self.__data, offset + 8, offset + 4 + length)
+            self.__cies[offset] = self.__parse_cie(reader)
+
+        return self.__cies[offset]
+
+    def __parse_fde(self, reader: Reader, cie_offset: int) -> Optional[Fde]:
+        cie = self.__get_cie(cie_offset)
+
+        pc_begin = self.__read_encoded(reader, cie.fde_encoding)
+        pc_size = self.__read_encoded(reader, cie.fde_encoding & 0x0F)
+        if pc_size == 0:
+            return None
+
+        fde = Fde(pc_begin, pc_begin + pc_size, cie.ret_reg, [])
+
+        # The PC of signal frames isn't adjusted before the lookup, the kernel
+        # only knows how to deal with those when going through .eh_frame.
+        if cie.signal_frame:
+            return fde
+
+        if cie.has_augmentation_data:
+            reader.offset += reader.uleb128()
+
+        assert cie.initial_rules
+        rows: List[Tuple[int, Rules]] = []
+
+        try:
+            self.__execute(
+                cie, reader, cie.initial_rules.copy(), pc_begin, rows
+            )
+        except Unsupported:
+            return fde
+
+        # Merge rows at the same location and those that don't change anything
+        for pc, rules in rows:
+            if fde.rows and fde.rows[-1][0] == pc:
+                fde.rows.pop()
+            if fde.rows and fde.rows[-1][1] == rules:
+                continue
+            if pc < fde.pc_end:
+                fde.rows.append((pc, rules))
+
+        return fde
+
+    def parse(self) -> List[Fde]:
+        fdes: List[Fde] = []
+        offset = 0
+
+        while offset + 4 <= len(self.__data):
+            length = struct.unpack_from("<I", self.__data, offset)[0]
+
+            # Zero terminator
+            if length == 0:
+                break
+            if length == 0xFFFFFFFF:
+                raise RuntimeError("64-bit DWARF is not supported")
+
+            reader = Reader(self.__data, offset + 4, offset + 4 + length)
+            cie_pointer = reader.u32()
+
+            if cie_pointer != 0:
+                try:
+                    fde = self.__parse_fde(reader, offset + 4 - cie_pointer)
+                    if fde:
+                        fdes.append(fde)
+                except Unsupported:
+                    pass
+
+            offset += 4 + length
+
+        fdes.sort(key=lambda fde: fde.pc_begin)
+        return fdes
+
+    @property
+    def num_registers(self) -> int:
+        return self.__num_registers
+
+
+@dataclass(frozen=True)
+class TableRule:
+    cfa_reg: int
+    cfa_offset: int
+    ret_reg: int
+    offsets: Tuple[Tuple[int, int], ...]
+
+
+class UnwindTable:
+    def __init__(self, text_begin: int, fdes: List[Fde]) -> None:
+        self.rules: List[TableRule] = []
+        self.rows: List[Tuple[int, int]] = []
+        self.num_fdes = 0
+        self.num_covered_fdes = 0
+
+        rule_indices: Dict[TableRule, int] = {}
+        prev_end = 0
+
+        for fde in fdes:
+            # Overlapping FDEs are bogus, leave the range to the first one
+            if fde.pc_begin < prev_end:
+                continue
+            if not 0 <= fde.pc_begin - text_begin < fde.pc_end - text_begin \
+                    < (1 << 32):
+                continue
+
+            self.num_fdes += 1
+            prev_end = fde.pc_end
+
+            if not fde.rows:
+                self.__add_row(fde.pc_begin - text_begin, NO_RULE)
+
+            for pc, rules in fde.rows:
+                rule = TableRule(
+                    rules.cfa_reg, rules.cfa_offset, fde.ret_reg,
+                    tuple(sorted(rules.offsets.items()))
+                )
+
+                if rule not in rule_indices:
+                    rule_indices[rule] = len(self.rules)
+                    self.rules.append(rule)
+
+                self.__add_row(pc - text_begin, rule_indices[rule])
+
+            if fde.rows:
+                self.num_covered_fdes += 1
+
+            # Terminates coverage unless another FDE starts right here
+            self.__add_row(fde.pc_end - text_begin, NO_RULE)
+
+        if len(self.rules) >= NO_RULE:
+            raise RuntimeError("Too many unique unwind rules")
+
+    def __add_row(self, pc: int, rule_index: int) -> None:
+        if self.rows and self.rows[-1][0] == pc:
+            self.rows.pop()
+        if self.rows and self.rows[-1][1] == rule_index:
+            return
+        if not self.rows and rule_index == NO_RULE:
+            return
+
+        self.rows.append((pc, rule_index))
+
+
+def find_text_begin(binary_path: str) -> int:
+    nm_output = subprocess.check_output(
+        ["nm", binary_path], universal_newlines=True
+    ).splitlines()
+
+    for line in nm_output:
+        address, _, name = line.split(" ")
+        if name == TEXT_BEGIN_SYMBOL:
+            return int(address, 16)
+
+    raise RuntimeError(f"{binary_path} has no {TEXT_BEGIN_SYMBOL} symbol")
+
+
+def emit_c_table(
+    path: str, num_registers: int, table: Optional[UnwindTable]
+) -> None:
+    rules = table.rules if table else []
+    rows = table.rows if table else []
+
+    with open(path, "w") as f:
+        f.write("#include <common/types.h>\n\n")
+        f.write("#include <private/unwind_table.h>\n\n")
+
+        f.write("const u32 g_unwind_table_num_registers = ")
+        f.write(f"{num_registers};\n\n")
+        f.write(f"const u32 g_unwind_table_size = {len(rows)};\n\n")
+
+        f.write("const u32 g_unwind_table_pcs[] = {\n")
+        for pc, _ in rows:
+            f.write(f"    0x{pc:08x},\n")
+        f.write("};\n\n")
+
+        f.write("const u16 g_unwind_table_rule_indices[] = {\n")
+        for _, rule_index in rows:
+            f.write(f"    0x{rule_index:04x},\n")
+        f.write("};\n\n")
+
+        f.write("const struct unwind_table_rule g_unwind_table_rules[] = {\n")
+        for rule in rules:
+            offsets = ", ".join(
+                f"[{reg}] = {offset}" for reg, offset in rule.offsets
+            )
+            f.write(
+                f"    {{ .cfa_offset = {rule.cfa_offset}, "
+                f".cfa_reg = {rule.cfa_reg}, .ret_reg = {rule.ret_reg}, "
+                f".reg_offsets = {{ {offsets} }} }},\n"
+            )
+        f.write("};\n")
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser("Generate the kernel unwind tables")
+    parser.add_argument("out_file", help="Target to output the unwind tables")
+    parser.add_argument("--binary",
+                        help="Path to the kernel binary, produces an empty "
+                             "table if omitted")
+    parser.add_argument("--stats", action="store_true",
+                        help="Print the table coverage and size")
+    args = parser.parse_args()
+
+    if not args.binary:
+        emit_c_table(args.out_file, 0, None)
+        return
+
+    elf = ElfFile(args.binary)
+    if elf.machine not in NUM_DWARF_REGISTERS:
+        raise RuntimeError(f"Unsupported ELF machine {elf.machine}")
+
+    eh_frame_parser = EhFrameParser(elf)
+    table = UnwindTable(find_text_begin(args.binary), eh_frame_parser.parse())
+
+    if args.stats:
+        print(f"{table.num_covered_fdes}/{table.num_fdes} FDEs covered, "
+              f"{len(table.rows)} rows, {len(table.rules)} unique rules")
+
+    emit_c_table(args.out_file, eh_frame_parser.num_registers, table)
+
+
+if __name__ == "__main__":
+    main()
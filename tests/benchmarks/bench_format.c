@@ -0,0 +1,153 @@
+/*
+ * Host-side comparison of the vsnprintf() integer conversion against the
+ * previous divide-per-digit loop, followed by whole-call timings for a set of
+ * specifier-heavy formats. Build with -m32 to see the effect on targets
+ * without native 64-bit division.
+ */
+#define ULTRA_ARCH_WIDTH sizeof(void*)
+
+#include <kernel-source/common/format.c>
+#include <kernel-source/common/string_container.c>
+#include <kernel-source/common/conversions.c>
+
+// After the kernel headers, which have their own snprintf()
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+void print(const char *msg, ...)
+{
+    UNREFERENCED_PARAMETER(msg);
+}
+
+error_t symbol_lookup_by_address(
+    ptr_t address, char out_name_buf[MAX_SYMBOL_LENGTH],
+    size_t *out_offset_within
+)
+{
+    UNREFERENCED_PARAMETER(address);
+    UNREFERENCED_PARAMETER(out_name_buf);
+    UNREFERENCED_PARAMETER(out_offset_within);
+
+    return ENOSYS;
+}
+
+void panic(const char *msg, ...)
+{
+    va_list vlist;
+
+    va_start(vlist, msg);
+    vfprintf(stderr, msg, vlist);
+    va_end(vlist);
+
+    abort();
+}
+
+#define ITERATIONS 2000000
+#define NUM_VALUES 1024
+
+// The conversion loop write_integer() used before the fast paths
+static size_t legacy_to_repr(char *end, u64 value, u32 base, bool upper)
+{
+    char *cur = end;
+
+    do {
+        u64 remainder = value % base;
+        value /= base;
+
+        if (base == 16)
+            *--cur = (upper ? g_upper_hex : g_lower_hex)[remainder];
+        else
+            *--cur = remainder + '0';
+    } while (value);
+
+    return end - cur;
+}
+
+static volatile size_t g_sink;
+
+static u64 now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+typedef size_t (*to_repr_fn)(char *end, u64 value, u32 base, bool upper);
+
+static u64 measure(to_repr_fn fn, const u64 *values, u32 base)
+{
+    char buf[REPR_BUFFER_SIZE];
+    u64 start = now_ns();
+
+    for (u32 i = 0; i < ITERATIONS; i++)
+        g_sink += fn(&buf[REPR_BUFFER_SIZE], values[i % NUM_VALUES], base, false);
+
+    return (now_ns() - start) * 1000 / ITERATIONS;
+}
+
+static void fill_values(u64 *values, u32 max_bits)
+{
+    u64 state = 0x2545F4914F6CDD1Dull;
+
+    for (u32 i = 0; i < NUM_VALUES; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        // Uniform over magnitudes rather than values
+        values[i] = state >> (64 - 1 - (i % max_bits));
+    }
+}
+
+struct heavy_format {
+    const char *fmt;
+    u64 args[4];
+};
+
+static const struct heavy_format g_heavy_formats[] = {
+    { "%llu %llx", { 123456789, 0xDEADBEEF } },
+    { "%016llX %-8s %hhx %hu", { 0xCAFE, (u64)"name", 0x1FF, 0x12345 } },
+    { "[%5d] %-12s: %#010x", { 42, (u64)"subsystem", 0xF00D } },
+    { "%lld%%, %zu/%zu, %c", { -17, 4096, 65536, 'x' } },
+    { "%+08lld|%-+8lld|%.3s|%*d", { -5, 5, (u64)"truncated", 6 } },
+};
+
+int main(void)
+{
+    static const u32 bases[] = { 10, 16, 8 };
+    u64 values[NUM_VALUES];
+    char buf[64];
+    u64 start;
+
+    printf("Picoseconds per conversion\n%-6s %-8s %10s %10s\n",
+           "base", "values", "legacy", "current");
+
+    for (size_t i = 0; i < sizeof(bases) / sizeof(bases[0]); i++) {
+        fill_values(values, 32);
+        printf("%-6u %-8s %10llu %10llu\n", bases[i], "32-bit",
+               measure(legacy_to_repr, values, bases[i]),
+               measure(integer_to_repr, values, bases[i]));
+
+        fill_values(values, 64);
+        printf("%-6u %-8s %10llu %10llu\n", bases[i], "64-bit",
+               measure(legacy_to_repr, values, bases[i]),
+               measure(integer_to_repr, values, bases[i]));
+    }
+
+    printf("\nNanoseconds per vsnprintf_array() call\n");
+
+    for (size_t i = 0; i < sizeof(g_heavy_formats) / sizeof(g_heavy_formats[0]); i++) {
+        const struct heavy_format *hf = &g_heavy_formats[i];
+
+        start = now_ns();
+        for (u32 j = 0; j < ITERATIONS; j++)
+            g_sink += vsnprintf_array(buf, sizeof(buf), hf->fmt, hf->args, 4);
+
+        printf("%-36s %6llu\n", hf->fmt, (now_ns() - start) / ITERATIONS);
+    }
+
+    return 0;
+}
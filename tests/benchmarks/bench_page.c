@@ -0,0 +1,183 @@
+/*
+ * Host-side measurement of how page clearing affects the cache footprint of a
+ * workload running concurrently on another CPU. The clear loops are the ones
+ * from kernel/arch/x86/page.c.
+ */
+#if defined(__x86_64__)
+
+#define ULTRA_ARCH_WIDTH 8
+
+#include <kernel-source/arch/x86/page.c>
+
+// After the kernel headers, which have their own snprintf()
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Pages cleared per measurement, far larger than any LLC
+#define CLEAR_PAGES (64 * 1024)
+
+// Workload that fits comfortably into L2/LLC, walked a cache line at a time
+#define WORKING_SET_SIZE (1024 * 1024)
+#define CACHE_LINE_SIZE 64
+
+// How long the workload is sampled for without any clearing going on
+#define WORKLOAD_NS 100000000ull
+
+void print(const char *msg, ...)
+{
+    UNREFERENCED_PARAMETER(msg);
+}
+
+void panic(const char *msg, ...)
+{
+    va_list vlist;
+
+    va_start(vlist, msg);
+    vfprintf(stderr, msg, vlist);
+    va_end(vlist);
+
+    abort();
+}
+
+void cpuid(u32 function, struct cpuid_res *id)
+{
+    asm volatile("cpuid"
+                 : "=a"(id->a), "=b"(id->b), "=c"(id->c), "=d"(id->d)
+                 : "a"(function), "c"(0));
+}
+
+error_t param_set_bool(struct string str, struct param *p)
+{
+    UNREFERENCED_PARAMETER(str);
+    UNREFERENCED_PARAMETER(p);
+
+    return ENOSYS;
+}
+
+size_t param_get_bool(struct string *str, struct param *p)
+{
+    UNREFERENCED_PARAMETER(str);
+    UNREFERENCED_PARAMETER(p);
+
+    return 0;
+}
+
+static void clear_page_none(void *page)
+{
+    UNREFERENCED_PARAMETER(page);
+}
+
+static u64 now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static atomic_bool g_stop;
+static volatile u8 *g_working_set;
+static _Atomic u64 g_passes;
+
+static void *workload_thread(void *arg)
+{
+    u64 sum = 0;
+    UNREFERENCED_PARAMETER(arg);
+
+    while (!atomic_load_explicit(&g_stop, memory_order_relaxed)) {
+        for (size_t i = 0; i < WORKING_SET_SIZE; i += CACHE_LINE_SIZE)
+            sum += g_working_set[i];
+
+        atomic_fetch_add_explicit(&g_passes, 1, memory_order_relaxed);
+    }
+
+    return (void*)(ptr_t)sum;
+}
+
+static u64 passes_now(void)
+{
+    return atomic_load_explicit(&g_passes, memory_order_relaxed);
+}
+
+static void run(const char *name, void (*clear)(void*), u8 *pages)
+{
+    pthread_t thread;
+    u64 start, clear_ns, workload_ns, passes;
+
+    atomic_store(&g_stop, false);
+    atomic_store(&g_passes, 0);
+    pthread_create(&thread, NULL, workload_thread, NULL);
+
+    // Let the workload warm up its working set before anything is cleared
+    while (passes_now() < 2)
+        ;
+
+    start = now_ns();
+    passes = passes_now();
+    for (size_t i = 0; i < CLEAR_PAGES; i++)
+        clear(pages + i * PAGE_SIZE);
+    clear_ns = now_ns() - start;
+    passes = passes_now() - passes;
+    workload_ns = clear_ns;
+
+    // Without any clearing there's nothing to time, sample the workload alone
+    if (clear == clear_page_none) {
+        start = now_ns();
+        passes = passes_now();
+        while (now_ns() - start < WORKLOAD_NS)
+            ;
+        passes = passes_now() - passes;
+        workload_ns = now_ns() - start;
+    }
+
+    atomic_store(&g_stop, true);
+    pthread_join(thread, NULL);
+
+    printf("%-12s clear: %6llu MiB/s   workload: %6llu ns/pass\n", name,
+           clear == clear_page_none ? 0ull :
+           (unsigned long long)(((u64)CLEAR_PAGES * PAGE_SIZE *
+                                 1000000000ull / clear_ns) >> 20),
+           (unsigned long long)(passes ? workload_ns / passes : 0));
+}
+
+int main(void)
+{
+    u8 *pages = aligned_alloc(PAGE_SIZE, (size_t)CLEAR_PAGES * PAGE_SIZE);
+    u8 *working_set = aligned_alloc(PAGE_SIZE, WORKING_SET_SIZE);
+
+    if (!pages || !working_set)
+        return 1;
+
+    for (size_t i = 0; i < WORKING_SET_SIZE; i++)
+        working_set[i] = (u8)i;
+    g_working_set = working_set;
+
+    // Fault everything in up front so that page faults don't skew results
+    for (size_t i = 0; i < CLEAR_PAGES; i++)
+        clear_page_rep(pages + i * PAGE_SIZE);
+
+    printf("Clearing %d MiB while another thread walks a %d KiB working set\n",
+           CLEAR_PAGES * PAGE_SIZE >> 20, WORKING_SET_SIZE >> 10);
+
+    run("idle", clear_page_none, pages);
+    run("rep stosq", clear_page_rep, pages);
+    run("movnti", clear_page_nt, pages);
+
+    free(pages);
+    free(working_set);
+    return 0;
+}
+
+#else
+
+int main(void)
+{
+    printf("Page clearing benchmark is only available on x86_64 hosts\n");
+    return 0;
+}
+
+#endif
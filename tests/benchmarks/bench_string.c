@@ -0,0 +1,303 @@
+/*
+ * Host-side throughput comparison of the kernel string routines against
+ * plain byte loops, REP MOVSB/STOSB and the host libc where applicable, for
+ * sizes from 8 bytes to 1 MiB.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <kernel-source/common/string.c>
+#include <kernel-source/common/string_container.c>
+
+void panic(const char *msg, ...)
+{
+    va_list vlist;
+
+    va_start(vlist, msg);
+    vfprintf(stderr, msg, vlist);
+    va_end(vlist);
+
+    abort();
+}
+
+#define MIN_SIZE 8
+#define MAX_SIZE (1024 * 1024)
+
+// Move roughly this many bytes per measurement regardless of size
+#define BYTES_PER_RUN (256ull * 1024 * 1024)
+
+typedef void (*copy_fn)(void *dest, const void *src, size_t count);
+
+static void copy_bytes(void *dest, const void *src, size_t count)
+{
+    u8 *cd = dest;
+    const u8 *cs = src;
+
+    while (count--)
+        *cd++ = *cs++;
+}
+
+static void copy_generic(void *dest, const void *src, size_t count)
+{
+    memcpy_generic(dest, src, count);
+}
+
+static void copy_libc(void *dest, const void *src, size_t count)
+{
+    memcpy(dest, src, count);
+}
+
+static void set_bytes(void *dest, const void *src, size_t count)
+{
+    u8 *cd = dest;
+    (void)src;
+
+    while (count--)
+        *cd++ = 0xAB;
+}
+
+static void set_generic(void *dest, const void *src, size_t count)
+{
+    (void)src;
+    memset_generic(dest, 0xAB, count);
+}
+
+static void set_libc(void *dest, const void *src, size_t count)
+{
+    (void)src;
+    memset(dest, 0xAB, count);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static void copy_rep_movsb(void *dest, const void *src, size_t count)
+{
+    asm volatile("rep movsb"
+                 : "+D"(dest), "+S"(src), "+c"(count)
+                 :: "memory");
+}
+
+static void set_rep_stosb(void *dest, const void *src, size_t count)
+{
+    (void)src;
+    asm volatile("rep stosb"
+                 : "+D"(dest), "+c"(count)
+                 : "a"(0xAB)
+                 : "memory");
+}
+#define HAVE_REP_STRING
+#endif
+
+struct bench_impl {
+    const char *name;
+    copy_fn fn;
+};
+
+/*
+ * The kernel strlen() and memcmp() replace the libc ones in this binary, so
+ * byte loops serve as the baseline instead.
+ */
+static volatile size_t g_sink;
+
+static void strlen_bytes(void *dest, const void *src, size_t count)
+{
+    const char *str = src;
+    (void)dest;
+    (void)count;
+
+    while (*str)
+        str++;
+
+    g_sink = str - (const char*)src;
+}
+
+static void strlen_word(void *dest, const void *src, size_t count)
+{
+    (void)dest;
+    (void)count;
+
+    g_sink = strlen(src);
+}
+
+static void memcmp_bytes(void *dest, const void *src, size_t count)
+{
+    const u8 *lhs = dest, *rhs = src;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        if (lhs[i] != rhs[i])
+            break;
+    }
+
+    g_sink = i;
+}
+
+static void memcmp_word(void *dest, const void *src, size_t count)
+{
+    g_sink = memcmp(dest, src, count);
+}
+
+// The str_find() implementation this replaced
+static ssize_t naive_find(struct string str, struct string needle)
+{
+    for (size_t i = 0; i + needle.size <= str.size; i++) {
+        size_t j;
+
+        for (j = 0; j < needle.size; j++) {
+            if (str.text[i + j] != needle.text[j])
+                break;
+        }
+
+        if (j == needle.size)
+            return i;
+    }
+
+    return -1;
+}
+
+#define FIND_NEEDLE_SIZE 16
+
+// The needle is always the tail of the haystack
+static struct string find_needle(const void *src, size_t count)
+{
+    size_t size = MIN(count, (size_t)FIND_NEEDLE_SIZE);
+
+    return (struct string) { { (const char*)src + count - size }, size };
+}
+
+static void str_find_naive(void *dest, const void *src, size_t count)
+{
+    struct string str = { { src }, count };
+    (void)dest;
+
+    g_sink = naive_find(str, find_needle(src, count));
+}
+
+static void str_find_horspool(void *dest, const void *src, size_t count)
+{
+    struct string str = { { src }, count };
+    (void)dest;
+
+    g_sink = str_find(str, find_needle(src, count), 0);
+}
+
+static const struct bench_impl g_copy_impls[] = {
+    { "bytes", copy_bytes },
+    { "generic", copy_generic },
+#ifdef HAVE_REP_STRING
+    { "rep movsb", copy_rep_movsb },
+#endif
+    { "libc", copy_libc },
+};
+
+static const struct bench_impl g_set_impls[] = {
+    { "bytes", set_bytes },
+    { "generic", set_generic },
+#ifdef HAVE_REP_STRING
+    { "rep stosb", set_rep_stosb },
+#endif
+    { "libc", set_libc },
+};
+
+static const struct bench_impl g_search_impls[] = {
+    { "strlen/b", strlen_bytes },
+    { "strlen/w", strlen_word },
+    { "memcmp/b", memcmp_bytes },
+    { "memcmp/w", memcmp_word },
+    { "find/naive", str_find_naive },
+    { "find/bmh", str_find_horspool },
+};
+
+static u64 now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*
+ * Makes 'src' a NUL-terminated string of 'size' characters that only
+ * matches the needle at its very end, and 'dest' equal to it.
+ */
+static void prepare_search(u8 *dest, const u8 *src, size_t size,
+                           size_t misalign)
+{
+    u8 *str = (u8*)src + misalign;
+
+    for (size_t i = 0; i < size; i++)
+        str[i] = 'a' + (i % 23);
+
+    if (size >= FIND_NEEDLE_SIZE)
+        str[size - FIND_NEEDLE_SIZE] = '#';
+
+    str[size] = '\0';
+    memcpy_generic(dest, str, size + 1);
+}
+
+#define RUN_TABLE(title, impls, dest, src, misalign) \
+    run_table(title, impls, sizeof(impls) / sizeof(impls[0]), \
+              dest, src, misalign)
+
+// Returns throughput in MiB/s
+static u64 measure(copy_fn fn, u8 *dest, const u8 *src, size_t size)
+{
+    u64 iterations = BYTES_PER_RUN / size, start, elapsed;
+
+    // Warm up caches and TLBs
+    fn(dest, src, size);
+
+    start = now_ns();
+    for (u64 i = 0; i < iterations; i++)
+        fn(dest, src, size);
+    elapsed = now_ns() - start;
+
+    if (!elapsed)
+        elapsed = 1;
+
+    return (iterations * size * 1000000000ull / elapsed) >> 20;
+}
+
+static void run_table(const char *title, const struct bench_impl *impls,
+                      size_t num_impls, u8 *dest, const u8 *src,
+                      size_t misalign)
+{
+    printf("\n%s (source misaligned by %zu), MiB/s\n%-10s", title, misalign,
+           "size");
+
+    for (size_t i = 0; i < num_impls; i++)
+        printf("%12s", impls[i].name);
+    printf("\n");
+
+    for (size_t size = MIN_SIZE; size <= MAX_SIZE; size *= 2) {
+        // Searches look at every byte, make sure they all get compared
+        prepare_search(dest, src, size, misalign);
+
+        printf("%-10zu", size);
+
+        for (size_t i = 0; i < num_impls; i++)
+            printf("%12llu", measure(impls[i].fn, dest, src + misalign, size));
+
+        printf("\n");
+    }
+}
+
+int main(void)
+{
+    u8 *src = aligned_alloc(4096, MAX_SIZE + 4096);
+    u8 *dest = aligned_alloc(4096, MAX_SIZE + 4096);
+
+    if (!src || !dest)
+        return 1;
+
+    RUN_TABLE("memcpy", g_copy_impls, dest, src, 0);
+    RUN_TABLE("memcpy", g_copy_impls, dest, src, 3);
+    RUN_TABLE("memset", g_set_impls, dest, src, 0);
+    RUN_TABLE("search", g_search_impls, dest, src, 3);
+
+    free(src);
+    free(dest);
+    return 0;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <common/types.h>
+#include <common/attributes.h>
+
+#define memcpy __builtin_memcpy
+#define memmove __builtin_memmove
+#define memset __builtin_memset
+#define memcmp __builtin_memcmp
+#define strlen __builtin_strlen
+
+/*
+ * Portable word-at-a-time implementations, the actual memcpy() and friends
+ * may be overridden by the architecture.
+ */
+void *memcpy_generic(void *dest, const void *src, size_t count);
+void *memmove_generic(void *dest, const void *src, size_t count);
+void *memset_generic(void *dest, int ch, size_t count);
+
+static ALWAYS_INLINE void *memzero(void *dest, size_t count)
+{
+    return memset(dest, 0, count);
+}
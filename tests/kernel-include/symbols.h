@@ -0,0 +1,72 @@
+#pragma once
+
+#include <common/types.h>
+#include <common/error.h>
+#include <common/string_container.h>
+
+#include <linker.h>
+
+extern u8 LINKER_SYMBOL(text_begin)[];
+extern u8 LINKER_SYMBOL(text_end)[];
+
+extern u8 LINKER_SYMBOL(eh_frame_hdr_begin)[];
+extern u8 LINKER_SYMBOL(eh_frame_hdr_end)[];
+
+extern u8 LINKER_SYMBOL(eh_frame_begin)[];
+extern u8 LINKER_SYMBOL(eh_frame_end)[];
+
+// 127 chars & a NULL terminator
+#define MAX_SYMBOL_LENGTH (127 + 1)
+
+static inline bool address_is_kernel_code(ptr_t address)
+{
+    return address >= (ptr_t)LINKER_SYMBOL(text_begin) &&
+           address <= (ptr_t)LINKER_SYMBOL(text_end);
+}
+
+/*
+ * Resolves 'address' into the name of the symbol containing it and the offset
+ * within that symbol. Recently resolved addresses are served from a small
+ * cache without decompressing the name again.
+ */
+error_t symbol_lookup_by_address(
+    ptr_t address, char out_name_buf[MAX_SYMBOL_LENGTH],
+    size_t *out_offset_within
+);
+
+/*
+ * Resolves a symbol name into its address, comparing the compressed names in
+ * place instead of decompressing every name visited by the search. If several
+ * symbols share the name, the one with the lowest address is returned.
+ */
+error_t symbol_lookup_by_name(struct string name, ptr_t *out_address);
+
+typedef bool (*symbol_cb_t)(void *user, const char *name, ptr_t address);
+
+/*
+ * Invokes 'callback' for every symbol whose name starts with 'prefix' in
+ * lexicographical order, e.g. to find tracing attach points. Names are only
+ * decompressed for symbols that match, iteration stops early if the callback
+ * returns false.
+ */
+error_t symbol_for_each_with_prefix(
+    struct string prefix, symbol_cb_t callback, void *user
+);
+
+/*
+ * A kernel symbol referenced by a module, 'address' is filled in by
+ * symbol_resolve_imports().
+ */
+struct symbol_import {
+    struct string name;
+    ptr_t address;
+};
+
+/*
+ * Resolves every import of a module being loaded, meant to be called by the
+ * loader before applying relocations. Stops at the first symbol that doesn't
+ * exist and returns ENOENT along with its index in 'out_failed_idx'.
+ */
+error_t symbol_resolve_imports(
+    struct symbol_import *imports, size_t count, size_t *out_failed_idx
+);
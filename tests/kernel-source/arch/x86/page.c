@@ -0,0 +1,143 @@
+#define MSG_FMT(msg) "page: " msg
+
+#include <common/align.h>
+#include <common/types.h>
+
+#include <bug.h>
+#include <log.h>
+#include <param.h>
+#include <memory/page.h>
+
+#include <arch/private/cpuid.h>
+#include <arch/private/page.h>
+
+#define CPUID_FEATURES 1
+#define FEATURES_D_SSE2 (1 << 26)
+
+#if ULTRA_ARCH_WIDTH == 8
+#define REP_STOS_WORD "rep stosq"
+#define REP_MOVS_WORD "rep movsq"
+#else
+#define REP_STOS_WORD "rep stosl"
+#define REP_MOVS_WORD "rep movsl"
+#endif
+
+#define WORDS_PER_PAGE (PAGE_SIZE / sizeof(ptr_t))
+
+static bool g_have_movnti;
+
+/*
+ * Use non-temporal stores for page-sized operations, defaults to on for CPUs
+ * that support MOVNTI. Unlike the rest of SSE2 it operates on general purpose
+ * registers, so it is fine to use even though the kernel is built without SSE.
+ */
+static bool g_nt_page_ops;
+
+void x86_page_ops_init(void)
+{
+    struct cpuid_res res;
+
+    cpuid(CPUID_FEATURES, &res);
+    g_have_movnti = (res.d & FEATURES_D_SSE2) != 0;
+    g_nt_page_ops = g_have_movnti;
+}
+
+static error_t nt_page_ops_set(struct string str, struct param *p)
+{
+    error_t ret;
+
+    ret = param_set_bool(str, p);
+    if (is_error(ret))
+        return ret;
+
+    if (g_nt_page_ops && !g_have_movnti) {
+        pr_warn("non-temporal stores not supported by this CPU\n");
+        g_nt_page_ops = false;
+        return EINVAL;
+    }
+
+    return EOK;
+}
+
+static const struct param_ops g_nt_page_ops_ops = {
+    .set = nt_page_ops_set,
+    .get = param_get_bool,
+};
+early_parameter_with_ops(g_nt_page_ops, g_nt_page_ops_ops);
+
+static void clear_page_rep(void *page)
+{
+    size_t count = WORDS_PER_PAGE;
+
+    asm volatile(REP_STOS_WORD
+                 : "+D"(page), "+c"(count)
+                 : "a"(0)
+                 : "memory");
+}
+
+static void copy_page_rep(void *dest, const void *src)
+{
+    size_t count = WORDS_PER_PAGE;
+
+    asm volatile(REP_MOVS_WORD
+                 : "+D"(dest), "+S"(src), "+c"(count)
+                 :: "memory");
+}
+
+/*
+ * Non-temporal stores are weakly ordered with respect to everything else,
+ * fence afterwards so that the page contents are visible before any store
+ * that publishes the page.
+ */
+static void clear_page_nt(void *page)
+{
+    ptr_t *cur = page, *end = cur + WORDS_PER_PAGE;
+
+    for (; cur < end; cur += 4) {
+        asm volatile("movnti %4, %0\n\t"
+                     "movnti %4, %1\n\t"
+                     "movnti %4, %2\n\t"
+                     "movnti %4, %3"
+                     : "=m"(cur[0]), "=m"(cur[1]), "=m"(cur[2]), "=m"(cur[3])
+                     : "r"((ptr_t)0));
+    }
+
+    asm volatile("sfence" ::: "memory");
+}
+
+static void copy_page_nt(void *dest, const void *src)
+{
+    ptr_t *cur = dest, *end = cur + WORDS_PER_PAGE;
+    const ptr_t *in = src;
+
+    for (; cur < end; cur += 4, in += 4) {
+        asm volatile("movnti %4, %0\n\t"
+                     "movnti %5, %1\n\t"
+                     "movnti %6, %2\n\t"
+                     "movnti %7, %3"
+                     : "=m"(cur[0]), "=m"(cur[1]), "=m"(cur[2]), "=m"(cur[3])
+                     : "r"(in[0]), "r"(in[1]), "r"(in[2]), "r"(in[3]));
+    }
+
+    asm volatile("sfence" ::: "memory");
+}
+
+void clear_page(void *page)
+{
+    BUG_ON(!IS_ALIGNED((ptr_t)page, PAGE_SIZE));
+
+    if (g_nt_page_ops)
+        clear_page_nt(page);
+    else
+        clear_page_rep(page);
+}
+
+void copy_page(void *dest, const void *src)
+{
+    BUG_ON(!IS_ALIGNED((ptr_t)dest, PAGE_SIZE));
+
+    if (g_nt_page_ops)
+        copy_page_nt(dest, src);
+    else
+        copy_page_rep(dest, src);
+}
@@ -0,0 +1,796 @@
+#include <common/types.h>
+#include <common/format.h>
+#include <common/minmax.h>
+#include <common/string.h>
+#include <common/string_container.h>
+#include <common/error.h>
+
+#include <symbols.h>
+
+struct fmt_state {
+    struct fmt_sink *sink;
+    size_t bytes_written;
+};
+
+struct fmt_spec {
+    u8 is_signed      : 1;
+    u8 prepend        : 1;
+    u8 uppercase      : 1;
+    u8 left_justify   : 1;
+    u8 alternate_form : 1;
+    u8 has_precision  : 1;
+    char pad_char;
+    char prepend_char;
+    u64 min_width;
+    u64 precision;
+    u32 base;
+};
+
+/*
+ * Arguments are either taken from a va_list or from an array of raw argument
+ * words, where every argument is widened to u64 (see vsnprintf_array).
+ */
+struct fmt_args {
+    va_list *vlist;
+    va_list vlist_copy;
+
+    const u64 *array;
+    size_t array_size;
+    size_t array_idx;
+    bool overrun;
+};
+
+static u64 next_array_arg(struct fmt_args *args)
+{
+    if (unlikely(args->array_idx == args->array_size)) {
+        args->overrun = true;
+        return 0;
+    }
+
+    return args->array[args->array_idx++];
+}
+
+#define fmt_arg_int(args, type)                            \
+    ((args)->vlist ? va_arg(*(args)->vlist, type) :        \
+                     (type)next_array_arg(args))
+
+#define fmt_arg_ptr(args, type)                            \
+    ((args)->vlist ? (type)va_arg(*(args)->vlist, void*) : \
+                     (type)(ptr_t)next_array_arg(args))
+
+// Returns false if the sink is full and doesn't take any more output
+static bool sink_make_room(struct fmt_sink *sink)
+{
+    if (sink->used < sink->capacity)
+        return true;
+    if (!sink->flush)
+        return false;
+
+    sink->flush(sink);
+    sink->used = 0;
+    return true;
+}
+
+static void write_one(struct fmt_state *st, char c)
+{
+    struct fmt_sink *sink = st->sink;
+
+    st->bytes_written++;
+
+    if (sink_make_room(sink))
+        sink->buf[sink->used++] = c;
+}
+
+static void write_many(struct fmt_state *st, const char *string, size_t count)
+{
+    struct fmt_sink *sink = st->sink;
+    size_t chunk;
+
+    st->bytes_written += count;
+
+    while (count && sink_make_room(sink)) {
+        chunk = MIN(count, sink->capacity - sink->used);
+        memcpy(&sink->buf[sink->used], string, chunk);
+
+        sink->used += chunk;
+        string += chunk;
+        count -= chunk;
+    }
+}
+
+static void write_repeated(struct fmt_state *st, char c, u64 count)
+{
+    while (count--)
+        write_one(st, c);
+}
+
+// Two decimal digits per entry, indexed by value * 2
+static const char g_digit_pairs[200] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char g_upper_hex[] = "0123456789ABCDEF";
+static const char g_lower_hex[] = "0123456789abcdef";
+
+/*
+ * The helpers below write the digits of 'value' backwards, ending right
+ * before 'end', and return the number of characters written. At least one
+ * digit is always produced.
+ */
+static size_t u32_to_pow2_repr(char *end, u32 value, u32 shift,
+                               const char *digits)
+{
+    char *cur = end;
+    u32 mask = (1 << shift) - 1;
+
+    do {
+        *--cur = digits[value & mask];
+        value >>= shift;
+    } while (value);
+
+    return end - cur;
+}
+
+static size_t u64_to_pow2_repr(char *end, u64 value, u32 shift,
+                               const char *digits)
+{
+    char *cur = end;
+    u32 mask = (1 << shift) - 1;
+
+    // Avoid 64-bit shifts on 32-bit targets for values that don't need them
+    while (value > 0xFFFFFFFF) {
+        *--cur = digits[value & mask];
+        value >>= shift;
+    }
+
+    cur -= u32_to_pow2_repr(cur, value, shift, digits);
+    return end - cur;
+}
+
+static void write_digit_pair(char *dst, u32 value)
+{
+    dst[0] = g_digit_pairs[value * 2];
+    dst[1] = g_digit_pairs[value * 2 + 1];
+}
+
+static size_t u32_to_dec_repr(char *end, u32 value)
+{
+    char *cur = end;
+
+    while (value >= 100) {
+        cur -= 2;
+        write_digit_pair(cur, value % 100);
+        value /= 100;
+    }
+
+    if (value >= 10) {
+        cur -= 2;
+        write_digit_pair(cur, value);
+    } else {
+        *--cur = '0' + value;
+    }
+
+    return end - cur;
+}
+
+static u64 mul_high_u64(u64 lhs, u64 rhs)
+{
+#ifdef __SIZEOF_INT128__
+    return ((unsigned __int128)lhs * rhs) >> 64;
+#else
+    u64 lhs_lo = (u32)lhs, lhs_hi = lhs >> 32;
+    u64 rhs_lo = (u32)rhs, rhs_hi = rhs >> 32;
+    u64 lo_lo = lhs_lo * rhs_lo;
+    u64 hi_lo = lhs_hi * rhs_lo;
+    u64 lo_hi = lhs_lo * rhs_hi;
+    u64 cross = (lo_lo >> 32) + (u32)hi_lo + lo_hi;
+
+    return lhs_hi * rhs_hi + (hi_lo >> 32) + (cross >> 32);
+#endif
+}
+
+#define DEC_CHUNK 100000000
+#define DEC_CHUNK_DIGITS 8
+
+/*
+ * Division by 10^8 as a multiplication by its reciprocal, 32-bit targets
+ * would otherwise go through the out-of-line 64-bit division helpers.
+ */
+static u64 div_dec_chunk(u64 value)
+{
+    return mul_high_u64(value, 0xABCC77118461CEFDull) >> 26;
+}
+
+static size_t u64_to_dec_repr(char *end, u64 value)
+{
+    char *cur = end;
+    size_t i;
+
+    // Peel off 8 digits at a time until the rest fits into 32 bits
+    while (value > 0xFFFFFFFF) {
+        u64 quotient = div_dec_chunk(value);
+        u32 chunk = value - quotient * DEC_CHUNK;
+
+        for (i = 0; i < DEC_CHUNK_DIGITS / 2; i++) {
+            cur -= 2;
+            write_digit_pair(cur, chunk % 100);
+            chunk /= 100;
+        }
+
+        value = quotient;
+    }
+
+    cur -= u32_to_dec_repr(cur, value);
+    return end - cur;
+}
+
+static size_t integer_to_repr(char *end, u64 value, u32 base, bool upper)
+{
+    const char *digits = upper ? g_upper_hex : g_lower_hex;
+
+    switch (base) {
+    case 16:
+        return u64_to_pow2_repr(end, value, 4, digits);
+    case 8:
+        return u64_to_pow2_repr(end, value, 3, digits);
+    default:
+        return u64_to_dec_repr(end, value);
+    }
+}
+
+#define REPR_BUFFER_SIZE 32
+
+static void write_integer(
+    struct fmt_state *st, struct fmt_spec *fm, u64 value
+)
+{
+    char repr_buffer[REPR_BUFFER_SIZE];
+    char prefix[3];
+    size_t prefix_size = 0, repr_size, index;
+    u64 zeroes = 0, total_size;
+
+    if (fm->is_signed) {
+        i64 as_ll = value;
+
+        if (as_ll < 0) {
+            value = -as_ll;
+            prefix[prefix_size++] = '-';
+        } else if (fm->prepend) {
+            prefix[prefix_size++] = fm->prepend_char;
+        }
+    }
+
+    if (fm->alternate_form && fm->base == 16 && value != 0) {
+        prefix[prefix_size++] = '0';
+        prefix[prefix_size++] = fm->uppercase ? 'X' : 'x';
+    }
+
+    repr_size = integer_to_repr(&repr_buffer[REPR_BUFFER_SIZE], value,
+                                fm->base, fm->uppercase);
+
+    // An explicit precision of zero prints nothing for a zero value
+    if (fm->has_precision && fm->precision == 0 && value == 0)
+        repr_size = 0;
+
+    index = REPR_BUFFER_SIZE - repr_size;
+
+    if (fm->has_precision && fm->precision > repr_size)
+        zeroes = fm->precision - repr_size;
+
+    // The octal alternate form guarantees a leading zero
+    if (fm->alternate_form && fm->base == 8 && zeroes == 0 &&
+        (repr_size == 0 || repr_buffer[index] != '0'))
+        prefix[prefix_size++] = '0';
+
+    total_size = prefix_size + zeroes + repr_size;
+
+    /*
+     * Zero padding goes between the prefix and the digits, and is ignored if
+     * the precision already determines the number of digits.
+     */
+    if (fm->min_width > total_size && !fm->left_justify &&
+        fm->pad_char == '0' && !fm->has_precision) {
+        zeroes += fm->min_width - total_size;
+        total_size = fm->min_width;
+    }
+
+    if (!fm->left_justify && fm->min_width > total_size)
+        write_repeated(st, ' ', fm->min_width - total_size);
+
+    write_many(st, prefix, prefix_size);
+    write_repeated(st, '0', zeroes);
+    write_many(st, &repr_buffer[index], repr_size);
+
+    if (fm->left_justify && fm->min_width > total_size)
+        write_repeated(st, ' ', fm->min_width - total_size);
+}
+
+/*
+ * Every byte of a conversion specification is classified with a single table
+ * lookup, the parser then walks the specification exactly once, moving
+ * forward through the flags, width, precision and length phases.
+ */
+enum fmt_class {
+    FMT_CLASS_INVALID = 0,
+    FMT_CLASS_FLAG,
+    FMT_CLASS_ZERO,
+    FMT_CLASS_DIGIT,
+    FMT_CLASS_STAR,
+    FMT_CLASS_DOT,
+    FMT_CLASS_LENGTH,
+    FMT_CLASS_CONVERSION,
+};
+
+static const u8 g_fmt_class[256] = {
+    ['+'] = FMT_CLASS_FLAG,
+    ['-'] = FMT_CLASS_FLAG,
+    [' '] = FMT_CLASS_FLAG,
+    ['#'] = FMT_CLASS_FLAG,
+    ['0'] = FMT_CLASS_ZERO,
+    ['1' ... '9'] = FMT_CLASS_DIGIT,
+    ['*'] = FMT_CLASS_STAR,
+    ['.'] = FMT_CLASS_DOT,
+    ['h'] = FMT_CLASS_LENGTH,
+    ['l'] = FMT_CLASS_LENGTH,
+    ['z'] = FMT_CLASS_LENGTH,
+    ['c'] = FMT_CLASS_CONVERSION,
+    ['s'] = FMT_CLASS_CONVERSION,
+    ['p'] = FMT_CLASS_CONVERSION,
+    ['d'] = FMT_CLASS_CONVERSION,
+    ['i'] = FMT_CLASS_CONVERSION,
+    ['o'] = FMT_CLASS_CONVERSION,
+    ['x'] = FMT_CLASS_CONVERSION,
+    ['X'] = FMT_CLASS_CONVERSION,
+    ['u'] = FMT_CLASS_CONVERSION,
+};
+
+enum fmt_phase {
+    FMT_PHASE_FLAGS,
+    FMT_PHASE_WIDTH,
+    FMT_PHASE_WIDTH_DONE,
+    FMT_PHASE_PRECISION_START,
+    FMT_PHASE_PRECISION,
+    FMT_PHASE_PRECISION_DONE,
+    FMT_PHASE_LENGTH,
+};
+
+enum fmt_length {
+    FMT_LENGTH_INVALID = -1,
+    FMT_LENGTH_INT,
+    FMT_LENGTH_CHAR,
+    FMT_LENGTH_SHORT,
+    FMT_LENGTH_LONG,
+    FMT_LENGTH_LONG_LONG,
+};
+
+static enum fmt_length length_from_specifier(
+    enum fmt_length current, char specifier
+)
+{
+    switch (specifier) {
+    case 'h':
+        if (current == FMT_LENGTH_INT)
+            return FMT_LENGTH_SHORT;
+        if (current == FMT_LENGTH_SHORT)
+            return FMT_LENGTH_CHAR;
+        break;
+    case 'l':
+        if (current == FMT_LENGTH_INT)
+            return FMT_LENGTH_LONG;
+        if (current == FMT_LENGTH_LONG)
+            return FMT_LENGTH_LONG_LONG;
+        break;
+    case 'z':
+        if (current == FMT_LENGTH_INT) {
+            return sizeof(size_t) == sizeof(long) ?
+                   FMT_LENGTH_LONG : FMT_LENGTH_LONG_LONG;
+        }
+        break;
+    }
+
+    return FMT_LENGTH_INVALID;
+}
+
+/*
+ * Parses everything between the '%' and the conversion specifier, which is
+ * returned via 'out_conversion'. 'fmt' points right after the '%' and is
+ * advanced past the specifier on success.
+ */
+static error_t parse_spec(
+    const char **fmt, struct fmt_spec *fm, enum fmt_length *out_length,
+    char *out_conversion, struct fmt_args *args
+)
+{
+    const char *cur = *fmt;
+    enum fmt_phase phase = FMT_PHASE_FLAGS;
+    enum fmt_length length = FMT_LENGTH_INT;
+    u64 *number = &fm->min_width;
+    char c;
+
+    for (;;) {
+        c = *cur++;
+
+        switch (g_fmt_class[(u8)c]) {
+        case FMT_CLASS_FLAG:
+            if (phase != FMT_PHASE_FLAGS)
+                return EINVAL;
+
+            if (c == '-') {
+                fm->left_justify = true;
+            } else if (c == '#') {
+                fm->alternate_form = true;
+            } else {
+                fm->prepend = true;
+                fm->prepend_char = c;
+            }
+            continue;
+
+        case FMT_CLASS_ZERO:
+            if (phase == FMT_PHASE_FLAGS) {
+                fm->pad_char = '0';
+                continue;
+            }
+            // A zero after the flags is just a digit
+            FALLTHROUGH;
+
+        case FMT_CLASS_DIGIT:
+            if (phase == FMT_PHASE_FLAGS)
+                phase = FMT_PHASE_WIDTH;
+            else if (phase == FMT_PHASE_PRECISION_START)
+                phase = FMT_PHASE_PRECISION;
+            else if (phase != FMT_PHASE_WIDTH && phase != FMT_PHASE_PRECISION)
+                return EINVAL;
+
+            if (unlikely(*number > (~0ull - 9) / 10))
+                return EOVERFLOW;
+
+            *number = *number * 10 + (c - '0');
+            continue;
+
+        case FMT_CLASS_STAR:
+            if (phase == FMT_PHASE_FLAGS)
+                phase = FMT_PHASE_WIDTH_DONE;
+            else if (phase == FMT_PHASE_PRECISION_START)
+                phase = FMT_PHASE_PRECISION_DONE;
+            else
+                return EINVAL;
+
+            *number = fmt_arg_int(args, int);
+            continue;
+
+        case FMT_CLASS_DOT:
+            if (phase > FMT_PHASE_WIDTH_DONE)
+                return EINVAL;
+
+            fm->has_precision = true;
+            number = &fm->precision;
+            phase = FMT_PHASE_PRECISION_START;
+            continue;
+
+        case FMT_CLASS_LENGTH:
+            if (phase == FMT_PHASE_PRECISION_START)
+                return EINVAL;
+
+            phase = FMT_PHASE_LENGTH;
+            length = length_from_specifier(length, c);
+            if (length == FMT_LENGTH_INVALID)
+                return EINVAL;
+            continue;
+
+        case FMT_CLASS_CONVERSION:
+            if (phase == FMT_PHASE_PRECISION_START)
+                return EINVAL;
+
+            *fmt = cur;
+            *out_length = length;
+            *out_conversion = c;
+            return EOK;
+
+        default:
+            return EINVAL;
+        }
+    }
+}
+
+static u32 base_from_specifier(char specifier)
+{
+    switch (specifier)
+    {
+        case 'x':
+        case 'X':
+            return 16;
+        case 'o':
+            return 8;
+        default:
+            return 10;
+    }
+}
+
+static bool is_uppercase_specifier(char specifier)
+{
+    return specifier == 'X';
+}
+
+static u64 fetch_integer(
+    struct fmt_args *args, enum fmt_length length, bool is_signed
+)
+{
+    switch (length) {
+    case FMT_LENGTH_CHAR:
+        return is_signed ? (u64)(signed char)fmt_arg_int(args, int) :
+                           (unsigned char)fmt_arg_int(args, int);
+    case FMT_LENGTH_SHORT:
+        return is_signed ? (u64)(signed short)fmt_arg_int(args, int) :
+                           (unsigned short)fmt_arg_int(args, int);
+    case FMT_LENGTH_LONG:
+        return is_signed ? (u64)fmt_arg_int(args, long) :
+                           fmt_arg_int(args, unsigned long);
+    case FMT_LENGTH_LONG_LONG:
+        return is_signed ? (u64)fmt_arg_int(args, long long) :
+                           fmt_arg_int(args, unsigned long long);
+    default:
+        return is_signed ? (u64)fmt_arg_int(args, i32) :
+                           fmt_arg_int(args, u32);
+    }
+}
+
+static void write_string(
+    struct fmt_state *st, struct fmt_spec *fm, const char *string
+)
+{
+    size_t size = 0;
+
+    if (unlikely(string == NULL))
+        string = "<null>";
+
+    while ((!fm->has_precision || size < fm->precision) && string[size])
+        size++;
+
+    if (!fm->left_justify && fm->min_width > size)
+        write_repeated(st, ' ', fm->min_width - size);
+
+    write_many(st, string, size);
+
+    if (fm->left_justify && fm->min_width > size)
+        write_repeated(st, ' ', fm->min_width - size);
+}
+
+static void write_sized_string(
+    struct fmt_state *st, struct fmt_spec *fm, struct string *string
+)
+{
+    size_t size;
+
+    if (WARN_ON(string == NULL)) {
+        static struct string null_string = STR("<null-string>");
+        string = &null_string;
+    }
+
+    size = string->size;
+    if (fm->has_precision)
+        size = MIN(fm->precision, string->size);
+
+    write_many(st, string->text, size);
+    if (fm->precision > size)
+        write_repeated(st, ' ', fm->precision - size);
+}
+
+static void write_symbol(struct fmt_state *st, ptr_t address, bool backtrace)
+{
+    char name[MAX_SYMBOL_LENGTH];
+    ptr_t lookup_address = backtrace ? address - 1 : address;
+    size_t offset;
+    struct fmt_spec fm = {
+        .alternate_form = true,
+        .pad_char = '0',
+        .min_width = ULTRA_ARCH_WIDTH * 2 + 2,
+        .base = 16,
+    };
+
+    if (is_error(symbol_lookup_by_address(lookup_address, name, &offset))) {
+        write_integer(st, &fm, address);
+        return;
+    }
+
+    write_many(st, name, strlen(name));
+    write_one(st, '+');
+
+    fm = (struct fmt_spec) { .base = 10 };
+    write_integer(st, &fm, offset + (address - lookup_address));
+}
+
+static MAYBE_NERR(int) do_vcbprintf(
+    struct fmt_state *st, const char *fmt_str, struct fmt_args *args
+)
+{
+    const char *fmt = fmt_str;
+    enum fmt_length length;
+    u64 value;
+    char conversion;
+    error_t ret;
+
+    for (;;) {
+        struct fmt_spec fm = {
+            .pad_char = ' ',
+            .base = 10,
+        };
+        const char *next = fmt;
+
+        while (*next && *next != '%')
+            next++;
+
+        if (next != fmt)
+            write_many(st, fmt, next - fmt);
+
+        fmt = next;
+        if (!*fmt)
+            break;
+
+        // consume %
+        fmt++;
+
+        if (*fmt == '%') {
+            write_one(st, '%');
+            fmt++;
+            continue;
+        }
+
+        ret = parse_spec(&fmt, &fm, &length, &conversion, args);
+        if (is_error(ret))
+            return -ret;
+
+        switch (conversion) {
+        case 'c':
+            if (length != FMT_LENGTH_INT)
+                return -EINVAL;
+
+            write_one(st, fmt_arg_int(args, int));
+            continue;
+
+        case 's':
+            if (length != FMT_LENGTH_INT)
+                return -EINVAL;
+
+            write_string(st, &fm, fmt_arg_ptr(args, char*));
+            continue;
+
+        case 'p':
+            if (length != FMT_LENGTH_INT)
+                return -EINVAL;
+
+            if (*fmt == 'S') {
+                fmt++;
+                write_sized_string(st, &fm, fmt_arg_ptr(args, struct string*));
+                continue;
+            }
+
+            if (*fmt == 'F' || *fmt == 'B') {
+                write_symbol(st, fmt_arg_ptr(args, ptr_t), *fmt++ == 'B');
+                continue;
+            }
+
+            value = fmt_arg_ptr(args, ptr_t);
+            fm.base = 16;
+            fm.min_width = ULTRA_ARCH_WIDTH * 2;
+            fm.pad_char = '0';
+            break;
+
+        case 'd':
+        case 'i':
+            fm.is_signed = true;
+            value = fetch_integer(args, length, true);
+            break;
+
+        default:
+            fm.base = base_from_specifier(conversion);
+            fm.uppercase = is_uppercase_specifier(conversion);
+            value = fetch_integer(args, length, false);
+            break;
+        }
+
+        write_integer(st, &fm, value);
+    }
+
+    if (unlikely(args->overrun))
+        return -EINVAL;
+
+    return st->bytes_written;
+}
+
+static MAYBE_NERR(int) vcbprintf_common(
+    struct fmt_sink *sink, const char *fmt_str, struct fmt_args *args
+)
+{
+    struct fmt_state st = { .sink = sink };
+    int ret;
+
+    ret = do_vcbprintf(&st, fmt_str, args);
+
+    if (sink->flush && sink->used) {
+        sink->flush(sink);
+        sink->used = 0;
+    }
+
+    return ret;
+}
+
+MAYBE_NERR(int) vcbprintf(
+    struct fmt_sink *sink, const char *fmt_str, va_list vlist
+)
+{
+    struct fmt_args args = { 0 };
+    int ret;
+
+    va_copy(args.vlist_copy, vlist);
+    args.vlist = &args.vlist_copy;
+    ret = vcbprintf_common(sink, fmt_str, &args);
+    va_end(args.vlist_copy);
+
+    return ret;
+}
+
+MAYBE_NERR(int) vcbprintf_array(
+    struct fmt_sink *sink, const char *fmt_str,
+    const u64 *array, size_t array_size
+)
+{
+    struct fmt_args args = {
+        .array = array,
+        .array_size = array_size,
+    };
+
+    return vcbprintf_common(sink, fmt_str, &args);
+}
+
+/*
+ * Buffer sinks truncate instead of flushing, keeping the last byte for the
+ * null terminator.
+ */
+static struct fmt_sink buffer_sink(char *buffer, size_t capacity)
+{
+    return (struct fmt_sink) {
+        .buf = buffer,
+        .capacity = capacity ? capacity - 1 : 0,
+    };
+}
+
+static void buffer_sink_terminate(struct fmt_sink *sink, size_t capacity)
+{
+    if (capacity)
+        sink->buf[sink->used] = '\0';
+}
+
+MAYBE_NERR(int) vsnprintf(
+    char *buffer, size_t capacity, const char *fmt_str, va_list vlist
+)
+{
+    struct fmt_sink sink = buffer_sink(buffer, capacity);
+    int ret;
+
+    ret = vcbprintf(&sink, fmt_str, vlist);
+    buffer_sink_terminate(&sink, capacity);
+
+    return ret;
+}
+
+MAYBE_NERR(int) vsnprintf_array(
+    char *buffer, size_t capacity, const char *fmt_str,
+    const u64 *array, size_t array_size
+)
+{
+    struct fmt_sink sink = buffer_sink(buffer, capacity);
+    int ret;
+
+    ret = vcbprintf_array(&sink, fmt_str, array, array_size);
+    buffer_sink_terminate(&sink, capacity);
+
+    return ret;
+}
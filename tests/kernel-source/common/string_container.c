@@ -0,0 +1,126 @@
+#include <common/string_container.h>
+#include <common/ctype.h>
+#include <common/minmax.h>
+#include <common/string.h>
+
+bool str_equals(struct string lhs, struct string rhs)
+{
+    if (lhs.size != rhs.size)
+        return false;
+
+    return memcmp(lhs.text, rhs.text, lhs.size) == 0;
+}
+
+bool str_equals_with_cb(
+    struct string lhs, struct string rhs,
+    bool (*are_equal)(char, char)
+)
+{
+    size_t i;
+
+    if (lhs.size != rhs.size)
+        return false;
+
+    for (i = 0; i < lhs.size; ++i) {
+        if (!are_equal(lhs.text[i], rhs.text[i]))
+            return false;
+    }
+
+    return true;
+}
+
+bool str_starts_with(struct string str, struct string prefix)
+{
+    if (prefix.size > str.size)
+        return false;
+
+    return memcmp(str.text, prefix.text, prefix.size) == 0;
+}
+
+ssize_t str_find_with_cb(
+    struct string str, bool (*is_match)(struct string str), size_t offset
+)
+{
+    BUG_ON(offset > str.size);
+    str_offset_by(&str, offset);
+
+    while (!str_empty(str)) {
+        if (is_match(str))
+            return offset;
+
+        str_offset_by(&str, 1);
+        offset += 1;
+    }
+
+    return -1;
+}
+
+/*
+ * Short needles or haystacks are matched by scanning for the first character
+ * of the needle, building the skip table costs more than it saves there.
+ */
+#define STR_FIND_MIN_NEEDLE 4
+#define STR_FIND_MIN_HAYSTACK 64
+
+// Skip distances are capped to what fits into a byte, which is still correct
+#define STR_FIND_MAX_SKIP 255u
+
+static ssize_t str_find_short(struct string str, struct string needle,
+                              size_t starting_at)
+{
+    size_t i, last = str.size - needle.size;
+    ssize_t idx;
+
+    for (i = starting_at; i <= last; i = idx + 1) {
+        idx = str_find_one(str, needle.text[0], i);
+        if (idx < 0 || (size_t)idx > last)
+            break;
+
+        if (memcmp(str.text + idx + 1, needle.text + 1, needle.size - 1) == 0)
+            return idx;
+    }
+
+    return -1;
+}
+
+/*
+ * Boyer-Moore-Horspool: compare the last character of the window first, and
+ * on mismatch shift by the distance from that character's last occurrence in
+ * the needle to the end of the needle.
+ */
+ssize_t str_find(struct string str, struct string needle, size_t starting_at)
+{
+    u8 skip[256];
+    size_t i, last_idx, default_skip;
+    char last_char;
+
+    BUG_ON(starting_at > str.size);
+
+    if (needle.size > (str.size - starting_at))
+        return -1;
+    if (str_empty(needle))
+        return starting_at;
+    if (needle.size < STR_FIND_MIN_NEEDLE ||
+        str.size - starting_at < STR_FIND_MIN_HAYSTACK)
+        return str_find_short(str, needle, starting_at);
+
+    last_idx = needle.size - 1;
+    last_char = needle.text[last_idx];
+    default_skip = MIN(needle.size, STR_FIND_MAX_SKIP);
+
+    memset(skip, default_skip, sizeof(skip));
+    for (i = 0; i < last_idx; i++)
+        skip[(u8)needle.text[i]] = MIN(last_idx - i, STR_FIND_MAX_SKIP);
+
+    for (i = starting_at; i <= str.size - needle.size;) {
+        char c = str.text[i + last_idx];
+
+        if (c == last_char &&
+            memcmp(str.text + i, needle.text, last_idx) == 0)
+            return i;
+
+        i += skip[(u8)c];
+    }
+
+    return -1;
+}
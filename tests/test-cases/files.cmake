@@ -1,4 +1,6 @@
 add_test_cases(
     test_boot_alloc.c
+    test_format.c
     test_parameter.c
+    test_string.c
 )
@@ -0,0 +1,246 @@
+#define ULTRA_ARCH_WIDTH sizeof(void*)
+
+#include <kernel-source/common/format.c>
+#include <test_harness.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * snprintf() and vsnprintf() resolve to the kernel implementation in this
+ * file, so the reference output comes from a host memory stream instead.
+ */
+static int host_format(char *buf, size_t capacity, const char *fmt, ...)
+{
+    char *out = NULL;
+    size_t out_size = 0;
+    FILE *stream;
+    va_list vlist;
+    int ret;
+
+    stream = open_memstream(&out, &out_size);
+    ASSERT(stream != NULL);
+
+    va_start(vlist, fmt);
+    ret = vfprintf(stream, fmt, vlist);
+    va_end(vlist);
+
+    fclose(stream);
+    ASSERT(ret >= 0);
+
+    if (capacity) {
+        size_t size = MIN(out_size, capacity - 1);
+
+        memcpy(buf, out, size);
+        buf[size] = '\0';
+    }
+
+    free(out);
+    return ret;
+}
+
+static void check_format(const char *fmt, u64 value)
+{
+    char expected[64], actual[64];
+    int expected_len, actual_len;
+
+    expected_len = host_format(expected, sizeof(expected), fmt, value);
+    actual_len = vsnprintf_array(actual, sizeof(actual), fmt, &value, 1);
+
+    if (actual_len != expected_len || strcmp(expected, actual) != 0)
+        panic("'%s': expected '%s', got '%s'\n", fmt, expected, actual);
+}
+
+static const char *const g_formats[] = {
+    "%llu", "%lld", "%llx", "%llX", "%llo", "%#llx", "%#llo", "%020llu",
+    "%-20lld|", "%+lld", "% lld", "%#020llX", "%3llu", "%+025lld",
+    "%-+25lld|", "%.5llx", "%#.3llo", "%#o", "%24.12lld", "%.0llu", "%08.3lld",
+};
+
+static void check_all_formats(u64 value)
+{
+    for (size_t i = 0; i < sizeof(g_formats) / sizeof(g_formats[0]); i++)
+        check_format(g_formats[i], value);
+}
+
+TEST_CASE(integer_boundaries) {
+    static const u64 values[] = {
+        0, 1, 7, 8, 9, 10, 15, 16, 99, 100, 101, 999, 1000, 65535,
+        99999999, 100000000, 100000001, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF,
+        0x100000000ull, 9999999999999999ull, 10000000000000000ull,
+        0x7FFFFFFFFFFFFFFFull, 0x8000000000000000ull, 0xFFFFFFFFFFFFFFFFull,
+    };
+
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+        check_all_formats(values[i]);
+}
+
+TEST_CASE(integer_powers_of_ten) {
+    u64 value = 1;
+
+    for (int i = 0; i < 20; i++, value *= 10) {
+        check_all_formats(value - 1);
+        check_all_formats(value);
+        check_all_formats(value + 1);
+    }
+}
+
+TEST_CASE(integer_random_values) {
+    u64 state = 0x2545F4914F6CDD1Dull;
+
+    for (int i = 0; i < 20000; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        // Spread values over all magnitudes
+        check_all_formats(state >> (i % 64));
+    }
+}
+
+static void check_format_array(const char *fmt, const u64 *args, size_t count)
+{
+    char expected[128], actual[128];
+    int expected_len, actual_len;
+
+    // Every argument used below is passed as a full word on the host
+    expected_len = host_format(expected, sizeof(expected), fmt,
+                                    args[0], args[1], args[2], args[3]);
+    actual_len = vsnprintf_array(actual, sizeof(actual), fmt, args, count);
+
+    if (actual_len != expected_len || strcmp(expected, actual) != 0)
+        panic("'%s': expected '%s', got '%s'\n", fmt, expected, actual);
+}
+
+TEST_CASE(mixed_specifications) {
+    u64 args[4] = { 12, (u64)"hello", 0xABC, 0 };
+
+    check_format_array("[%-5llu|%8s|%#10llx]", args, 3);
+    check_format_array("[%05llu|%.3s|%-#8llX]", args, 3);
+    check_format_array("[%+llu|%-8.2s|%llo]", args, 3);
+
+    args[0] = 7;
+    check_format_array("[%*s|%.*llu]", args, 4);
+    args[0] = 6;
+    args[1] = 3;
+    args[2] = (u64)"truncated";
+    check_format_array("[%*.*s]", args, 3);
+
+    check_format_array("%c%%%c", (u64[]) { 'a', 'b', 0, 0 }, 2);
+    check_format_array("%zu %zx %li", (u64[]) { 1, 255, -3, 0 }, 3);
+}
+
+TEST_CASE(invalid_specifications) {
+    static const char *const formats[] = {
+        "%", "%q", "%hhhd", "%lll", "%lc", "%hs", "%5*d", "%.d", "%.-3d",
+        "%-5", "%l", "%5.3", "%zzu", "%hl", "%*.*",
+    };
+    u64 args[4] = { 0 };
+    char buf[32];
+
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        if (vsnprintf_array(buf, sizeof(buf), formats[i], args, 4) >= 0)
+            panic("'%s' was accepted\n", formats[i]);
+    }
+}
+
+#define FAKE_SYMBOL_BEGIN 0x1000
+#define FAKE_SYMBOL_END   0x1100
+
+error_t symbol_lookup_by_address(
+    ptr_t address, char out_name_buf[MAX_SYMBOL_LENGTH],
+    size_t *out_offset_within
+)
+{
+    if (address < FAKE_SYMBOL_BEGIN || address >= FAKE_SYMBOL_END)
+        return EINVAL;
+
+    strcpy(out_name_buf, "fake_function");
+    *out_offset_within = address - FAKE_SYMBOL_BEGIN;
+    return EOK;
+}
+
+TEST_CASE(symbolic_pointers) {
+    char buf[64], expected[64];
+    u64 args[] = { FAKE_SYMBOL_BEGIN + 0x10, FAKE_SYMBOL_END, 0x42 };
+
+    ASSERT_EQ(vsnprintf_array(buf, sizeof(buf), "%pF %pB", args, 2), 34);
+    ASSERT_EQ(strcmp(buf, "fake_function+16 fake_function+256"), 0);
+
+    // Neither resolvable as a function nor as a return address
+    args[0] = FAKE_SYMBOL_END;
+    args[1] = FAKE_SYMBOL_BEGIN;
+    host_format(expected, sizeof(expected), "%#0*llx %#0*llx",
+                (int)sizeof(void*) * 2 + 2, (u64)FAKE_SYMBOL_END,
+                (int)sizeof(void*) * 2 + 2, (u64)FAKE_SYMBOL_BEGIN);
+    vsnprintf_array(buf, sizeof(buf), "%pF %pB", args, 2);
+    ASSERT_EQ(strcmp(buf, expected), 0);
+}
+
+TEST_CASE(narrow_integers) {
+    char buf[64];
+    u64 args[] = { (u64)-5, 0xFFFFFFFF, 0x1FF, 0x12345 };
+
+    ASSERT_EQ(vsnprintf_array(buf, sizeof(buf), "%d %u %hhx %hx", args, 4), 21);
+    ASSERT_EQ(strcmp(buf, "-5 4294967295 ff 2345"), 0);
+}
+
+struct collect_sink {
+    struct fmt_sink sink;
+    char chunk[7];
+    char out[256];
+    size_t out_size;
+    size_t flushes;
+};
+
+static void collect_flush(struct fmt_sink *sink)
+{
+    struct collect_sink *cs = container_of(sink, struct collect_sink, sink);
+
+    ASSERT(sink->used != 0);
+    memcpy(&cs->out[cs->out_size], sink->buf, sink->used);
+    cs->out_size += sink->used;
+    cs->flushes++;
+}
+
+TEST_CASE(callback_sink_streams_everything) {
+    struct collect_sink cs = { 0 };
+    char expected[256];
+    u64 args[] = { 123456789, (u64)"a string longer than the chunk", 0xBEEF };
+    const char *fmt = "value %llu, str '%s', hex %#llx, %% done";
+    int expected_len;
+
+    cs.sink = (struct fmt_sink) {
+        .buf = cs.chunk,
+        .capacity = sizeof(cs.chunk),
+        .flush = collect_flush,
+    };
+
+    expected_len = vsnprintf_array(expected, sizeof(expected), fmt, args, 3);
+    ASSERT_EQ(vcbprintf_array(&cs.sink, fmt, args, 3), expected_len);
+    ASSERT_EQ(cs.out_size, expected_len);
+    ASSERT_EQ(memcmp(cs.out, expected, expected_len), 0);
+    ASSERT_EQ(cs.flushes, (expected_len + sizeof(cs.chunk) - 1) /
+                          sizeof(cs.chunk));
+    ASSERT_EQ(cs.sink.used, 0);
+}
+
+TEST_CASE(buffer_sink_truncates) {
+    char buf[8];
+    u64 args[] = { 1234567890123ull };
+
+    for (size_t capacity = 0; capacity <= sizeof(buf); capacity++) {
+        memset(buf, 'X', sizeof(buf));
+        ASSERT_EQ(vsnprintf_array(buf, capacity, "%llu", args, 1), 13);
+
+        if (capacity == 0) {
+            ASSERT_EQ(buf[0], 'X');
+            continue;
+        }
+
+        ASSERT_EQ(strlen(buf), capacity - 1);
+        ASSERT_EQ(memcmp(buf, "1234567890123", capacity - 1), 0);
+    }
+}
@@ -0,0 +1,174 @@
+#include <common/string_container.h>
+#include <kernel-source/common/string.c>
+#include <test_harness.h>
+
+#define BUF_SIZE 256
+#define MAX_OFFSET 16
+#define MAX_COUNT 160
+
+static u8 g_buf[BUF_SIZE];
+static u8 g_expected[BUF_SIZE];
+
+static void fill_pattern(u8 *buf, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        buf[i] = (u8)(i * 7 + 3);
+}
+
+static void reset_buffers(void)
+{
+    for (size_t i = 0; i < BUF_SIZE; i++)
+        g_buf[i] = g_expected[i] = 0xCC;
+}
+
+static void verify_buffer(void)
+{
+    for (size_t i = 0; i < BUF_SIZE; i++)
+        ASSERT_EQ(g_buf[i], g_expected[i]);
+}
+
+TEST_CASE(memcpy_all_alignments) {
+    u8 src[BUF_SIZE];
+    fill_pattern(src, sizeof(src));
+
+    for (size_t dst_off = 0; dst_off < MAX_OFFSET; dst_off++) {
+    for (size_t src_off = 0; src_off < MAX_OFFSET; src_off++) {
+    for (size_t count = 0; count < MAX_COUNT; count++) {
+        reset_buffers();
+
+        for (size_t i = 0; i < count; i++)
+            g_expected[dst_off + i] = src[src_off + i];
+
+        ASSERT(memcpy_generic(g_buf + dst_off, src + src_off, count) ==
+               g_buf + dst_off);
+        verify_buffer();
+    }}}
+}
+
+TEST_CASE(memmove_overlapping) {
+    for (size_t dst_off = 0; dst_off < MAX_OFFSET * 2; dst_off++) {
+    for (size_t src_off = 0; src_off < MAX_OFFSET * 2; src_off++) {
+    for (size_t count = 0; count < MAX_COUNT; count++) {
+        u8 tmp[MAX_COUNT];
+
+        fill_pattern(g_buf, sizeof(g_buf));
+        fill_pattern(g_expected, sizeof(g_expected));
+
+        for (size_t i = 0; i < count; i++)
+            tmp[i] = g_expected[src_off + i];
+        for (size_t i = 0; i < count; i++)
+            g_expected[dst_off + i] = tmp[i];
+
+        ASSERT(memmove_generic(g_buf + dst_off, g_buf + src_off, count) ==
+               g_buf + dst_off);
+        verify_buffer();
+    }}}
+}
+
+TEST_CASE(memset_all_alignments) {
+    for (size_t off = 0; off < MAX_OFFSET; off++) {
+    for (size_t count = 0; count < MAX_COUNT; count++) {
+        reset_buffers();
+
+        for (size_t i = 0; i < count; i++)
+            g_expected[off + i] = 0xA5;
+
+        // Only the low byte of the fill value is used
+        ASSERT(memset_generic(g_buf + off, 0x1A5, count) == g_buf + off);
+        verify_buffer();
+    }}
+}
+
+TEST_CASE(strlen_all_alignments) {
+    for (size_t off = 0; off < MAX_OFFSET; off++) {
+    for (size_t len = 0; len < MAX_COUNT; len++) {
+        reset_buffers();
+        g_buf[off + len] = '\0';
+
+        // Zero bytes past the terminator must not matter either
+        g_buf[off + len + 1] = '\0';
+
+        ASSERT_EQ(strlen((const char*)g_buf + off), len);
+
+        // High bit characters must not be mistaken for zero bytes
+        for (size_t i = 0; i < len; i++)
+            g_buf[off + i] = 0x80 | (u8)i;
+        ASSERT_EQ(strlen((const char*)g_buf + off), len);
+    }}
+}
+
+static int sign_of(int value)
+{
+    return (value > 0) - (value < 0);
+}
+
+TEST_CASE(memcmp_mismatch_positions) {
+    u8 rhs[BUF_SIZE];
+
+    for (size_t off = 0; off < MAX_OFFSET; off++) {
+    for (size_t count = 1; count < MAX_COUNT; count++) {
+        fill_pattern(g_buf, sizeof(g_buf));
+        fill_pattern(rhs, sizeof(rhs));
+        ASSERT_EQ(memcmp(g_buf + off, rhs + off, count), 0);
+
+        for (size_t pos = 0; pos < count; pos++) {
+            u8 saved = rhs[off + pos];
+
+            // Bytes must compare as unsigned
+            g_buf[off + pos] = 0x10;
+            rhs[off + pos] = 0x90;
+            ASSERT_EQ(sign_of(memcmp(g_buf + off, rhs + off, count)), -1);
+
+            // Differences later in the buffer must not override the first one
+            if (pos + 1 < count)
+                g_buf[off + count - 1] = rhs[off + count - 1] + 1;
+            ASSERT_EQ(sign_of(memcmp(rhs + off, g_buf + off, count)), 1);
+
+            fill_pattern(g_buf, sizeof(g_buf));
+            rhs[off + pos] = saved;
+        }
+    }}
+}
+
+static ssize_t naive_find(struct string str, struct string needle,
+                          size_t starting_at)
+{
+    for (size_t i = starting_at; i + needle.size <= str.size; i++) {
+        size_t j;
+
+        for (j = 0; j < needle.size; j++) {
+            if (str.text[i + j] != needle.text[j])
+                break;
+        }
+
+        if (j == needle.size)
+            return i;
+    }
+
+    return -1;
+}
+
+TEST_CASE(str_find_matches_naive_search) {
+    static const char haystack[] =
+        "abracadabra abracadabrax aaaaaaaaab the quick brown fox jumps over "
+        "the lazy dog, ababababcabababab \xff\xfe\xff\xfe\xfd";
+    struct string str = STR(haystack);
+
+    // Every substring of the haystack must be found at its first occurrence
+    for (size_t begin = 0; begin < str.size; begin += 3) {
+    for (size_t len = 1; len <= 12 && begin + len <= str.size; len++) {
+        struct string needle = str_substring(str, begin, begin + len);
+
+        for (size_t start = 0; start <= begin; start += 5) {
+            ASSERT_EQ(str_find(str, needle, start),
+                      naive_find(str, needle, start));
+        }
+    }}
+
+    ASSERT_EQ(str_find(str, STR("abracadabray"), 0), -1);
+    ASSERT_EQ(str_find(str, STR("aaaab"), 0), 30);
+    ASSERT_EQ(str_find(str, STR("abababc"), 0),
+              naive_find(str, STR("abababc"), 0));
+    ASSERT_EQ(str_find(str, STR("dog"), str.size), -1);
+    ASSERT_EQ(str_find(str, STR(""), 7), 7);
+}